@@ -1,325 +1,474 @@
 #include "AudioCapture.h"
 
-#include <Audioclient.h>
-#include <mmdeviceapi.h>
-#include <mmsystem.h>
-#include <Windows.h>
+#include "AudioCaptureFile.h"
+#include "AudioCapturePipe.h"
+#include "AudioCaptureSignal.h"
+#ifdef _WIN32
+#include "AudioCaptureWasapi.h"
+#endif
 
 #include <stddef.h>
 #include <stdint.h>
 
 #include <cmath>
-#include <cstring>
+#include <cstdlib>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
-#include <numeric>
+#include <string>
+#include <thread>
 
-CLSID const CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
-IID const IID_IMMDeviceEnumerator = __uuidof(IMMDeviceEnumerator);
-IID const IID_IMMNotificationClient = __uuidof(IMMNotificationClient);
-IID const IID_IAudioClient = __uuidof(IAudioClient);
-IID const IID_IAudioCaptureClient = __uuidof(IAudioCaptureClient);
+static bool ParseRawFormat(std::string const& spec, size_t& sampleRate, size_t& numChannels, SampleFormat& sampleFormat)
+{
+    size_t first = spec.find(',');
+    size_t second = first == std::string::npos ? std::string::npos : spec.find(',', first + 1);
+    if (second == std::string::npos)
+        return false;
+
+    sampleRate = std::strtoul(spec.substr(0, first).c_str(), nullptr, 10);
+    numChannels = std::strtoul(spec.substr(first + 1, second - first - 1).c_str(), nullptr, 10);
+
+    return sampleRate > 0 && numChannels > 0 && ParseSampleFormat(spec.substr(second + 1), sampleFormat);
+}
 
-AudioCapture::AudioCapture(REFERENCE_TIME windowDuration)
+AudioCapture* AudioCapture::Create(std::string const& source)
+{
+    size_t sampleRate;
+    size_t numChannels;
+    SampleFormat sampleFormat;
+
+    std::string kind = source.substr(0, source.find(':'));
+    std::string args = kind.length() < source.length() ? source.substr(kind.length() + 1) : std::string();
+
+    if (kind.empty() || kind == "wasapi")
+    {
+#ifdef _WIN32
+        return new AudioCaptureWasapi();
+#else
+        std::cerr << "WASAPI capture is not available on this platform" << std::endl;
+        return nullptr;
+#endif
+    }
+    else if (kind == "file" && !args.empty())
+    {
+        return new AudioCaptureFile(args);
+    }
+    else if (kind == "raw")
+    {
+        size_t separator = args.find(':');
+        if (separator != std::string::npos &&
+            ParseRawFormat(args.substr(0, separator), sampleRate, numChannels, sampleFormat))
+            return new AudioCaptureFile(args.substr(separator + 1), sampleRate, numChannels, sampleFormat);
+    }
+    else if (kind == "pipe")
+    {
+        if (args.empty())
+            return new AudioCapturePipe();
+        if (ParseRawFormat(args, sampleRate, numChannels, sampleFormat))
+            return new AudioCapturePipe(sampleRate, numChannels, sampleFormat);
+    }
+    else if (kind == "signal")
+    {
+        if (args.empty())
+            return new AudioCaptureSignal();
+        return new AudioCaptureSignal(std::strtof(args.c_str(), nullptr));
+    }
+
+    std::cerr << "Unknown audio source: " << source << std::endl;
+    return nullptr;
+}
+
+AudioCapture::AudioCapture(float windowDuration)
     : m_windowDuration(windowDuration)
-    , m_enumerator()
-    , m_notificationClient()
-    , m_device()
-    , m_audioClient()
-    , m_wfx()
-    , m_requestedCaptureDuration(REFTIMES_PER_SEC)
-    , m_audioCaptureClient()
+    , m_sampleRate()
+    , m_numChannels()
+    , m_sampleFormat(SampleFormat::Float32)
+    , m_convert()
+    , m_deinterleave()
+    , m_isCapturing(false)
+    , m_didCaptureFail(false)
+    , m_windowNumSamples()
+    , m_windowIndex()
+    , m_frameNumSamples()
+    , m_hopNumSamples()
+    , m_maxNumFrames(1)
+    , m_numFrames()
+    , m_frameIndex()
+    , m_nextFrameEnd()
+    , m_captureIndex()
+    , m_numNewSamples()
+    , m_isWindowSilent(false)
+    , m_windowDevicePosition()
+    , m_isPacketTagged(false)
+    , m_packetDevicePosition()
+    , m_nextDevicePosition()
+    , m_anchorSequence(0)
+    , m_anchorIndex(0)
+    , m_anchorDevicePosition(0)
+    , m_anchorTime(0)
+    , m_numGlitches(0)
 {
-    if (!Initialize())
-        std::cerr << "Could not initialize AudioCapture" << std::endl;
 }
 
 AudioCapture::~AudioCapture()
 {
-    if (m_isInitialized)
-        Destroy();
+    Stop();
 }
 
-bool AudioCapture::Initialize()
+bool AudioCapture::Start()
 {
-    HRESULT hr;
-
-    hr = CoCreateInstance(
-        CLSID_MMDeviceEnumerator, nullptr, CLSCTX_ALL,
-        IID_IMMDeviceEnumerator, (LPVOID*)&m_enumerator);
-    if (FAILED(hr))
-        goto fail;
-
-    m_notificationClient = new AudioCaptureNotify();
+    if (m_isCapturing)
+        return true;
 
-    hr = m_enumerator->RegisterEndpointNotificationCallback(m_notificationClient);
-    if (FAILED(hr))
-        goto fail;
+    m_didCaptureFail = false;
+    m_isCapturing = true;
 
-    if (!InitializeDefaultDeviceCapture())
-        goto fail;
+    try
+    {
+        m_captureThread = std::thread(&AudioCapture::CaptureThread, this);
+    }
+    catch (...)
+    {
+        m_isCapturing = false;
+        return false;
+    }
 
-    m_isInitialized = true;
     return true;
-
-fail:
-    Destroy();
-    return false;
 }
 
-void AudioCapture::Destroy()
+void AudioCapture::Stop()
 {
-    DestroyDefaultDeviceCapture();
+    m_isCapturing = false;
 
-    if (m_notificationClient)
-        m_enumerator->UnregisterEndpointNotificationCallback(m_notificationClient);
-    if (m_enumerator)
-        m_enumerator->Release();
+    if (m_captureThread.joinable())
+        m_captureThread.join();
 }
 
-bool AudioCapture::Capture()
+void AudioCapture::CaptureThread()
 {
-    static auto AddSampleToBuffer = [this](float sample)
+    while (m_isCapturing)
     {
-        m_buffer[(m_windowOffset++) + m_windowSize] = sample;
+        WaitForPackets();
 
-        if (m_windowOffset >= m_windowSize)
+        if (!ReadPackets())
         {
-            std::copy(m_buffer.begin() + m_windowSize, m_buffer.end(), m_buffer.begin());
-            m_windowOffset = 0;
+            m_didCaptureFail = true;
+            break;
         }
-    };
+    }
+}
 
-    static UINT32 lastNumFramesAvailable = 0;
+bool AudioCapture::Capture()
+{
+    if (m_didCaptureFail)
+        return false;
 
-    HRESULT hr;
-    UINT32 numFramesInNextPacket;
-    UINT32 numFramesAvailable;
-    BYTE* data;
-    DWORD flags;
-    float averagedSample;
+    // one snapshot for every channel, so they all see the same frames
+    size_t writeIndex = m_ring.GetWriteIndex();
 
-    hr = m_audioCaptureClient->GetNextPacketSize(&numFramesInNextPacket);
-    if (FAILED(hr))
-        return false;
+    m_numNewSamples = writeIndex - m_captureIndex;
+    m_captureIndex = writeIndex;
 
-    if (numFramesInNextPacket == 0)
+    if (m_hopNumSamples == 0)
     {
-        for (size_t i = 0; i < lastNumFramesAvailable; ++i)
-            AddSampleToBuffer(0.f);
+        m_numFrames = 1;
+        m_frameIndex = writeIndex - m_frameNumSamples;
+        m_windowIndex = writeIndex - m_windowNumSamples;
     }
-
-    while (numFramesInNextPacket > 0)
+    else
     {
-        hr = m_audioCaptureClient->GetBuffer(&data, &numFramesAvailable, &flags, nullptr, nullptr);
-        if (FAILED(hr))
-            return false;
+        size_t numFrames = (ptrdiff_t)(writeIndex - m_nextFrameEnd) >= 0 ? (writeIndex - m_nextFrameEnd) / m_hopNumSamples + 1 : 0;
 
-        lastNumFramesAvailable = numFramesAvailable;
-
-        for (size_t i = 0; i < numFramesAvailable; ++i)
+        // after a stall only the newest frames are worth analyzing
+        if (numFrames > m_maxNumFrames)
         {
-            std::memcpy(m_aux.data(), &data[i * m_wfx->nBlockAlign], m_wfx->nBlockAlign);
-            averagedSample = std::accumulate(m_aux.begin(), m_aux.end(), 0.f) / m_wfx->nChannels;
+            m_nextFrameEnd += (numFrames - m_maxNumFrames) * m_hopNumSamples;
+            numFrames = m_maxNumFrames;
+        }
 
-            AddSampleToBuffer(averagedSample);
+        m_numFrames = numFrames;
+        m_frameIndex = m_nextFrameEnd - m_frameNumSamples;
+
+        if (numFrames > 0)
+        {
+            m_windowIndex = m_nextFrameEnd + (numFrames - 1) * m_hopNumSamples - m_windowNumSamples;
+            m_nextFrameEnd += numFrames * m_hopNumSamples;
         }
+    }
+
+    // anything older than the first frame is dropped unread; the frames themselves stay unread
+    // so the producer cannot overwrite them while they are analyzed
+    m_ring.SkipTo(m_frameIndex);
 
-        hr = m_audioCaptureClient->ReleaseBuffer(numFramesAvailable);
-        if (FAILED(hr))
-            return false;
+    m_isWindowSilent = m_ring.GetNumSilent(writeIndex) >= writeIndex - m_frameIndex;
 
-        hr = m_audioCaptureClient->GetNextPacketSize(&numFramesInNextPacket);
-        if (FAILED(hr))
-            return false;
+    size_t windowEnd = m_windowIndex + m_windowNumSamples;
+
+    uint32_t sequence;
+    size_t anchorIndex;
+    uint64_t anchorDevicePosition;
+    int64_t anchorTime;
+
+    do
+    {
+        sequence = m_anchorSequence.load(std::memory_order_acquire);
+        anchorIndex = m_anchorIndex.load(std::memory_order_relaxed);
+        anchorDevicePosition = m_anchorDevicePosition.load(std::memory_order_relaxed);
+        anchorTime = m_anchorTime.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || sequence != m_anchorSequence.load(std::memory_order_relaxed));
+
+    if (sequence == 0)
+    {
+        m_windowDevicePosition = windowEnd;
+        m_windowTime = std::chrono::steady_clock::now();
+    }
+    else
+    {
+        // the anchor may be older or newer than the window, either way the frames in between are contiguous
+        int64_t offset = (int64_t)(windowEnd - anchorIndex);
+
+        m_windowDevicePosition = anchorDevicePosition + offset;
+        m_windowTime = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(anchorTime))
+            + std::chrono::nanoseconds(offset * 1000000000 / (int64_t)m_sampleRate);
     }
 
     return true;
 }
 
-float const* AudioCapture::GetWindowData() const
+float const* AudioCapture::GetWindowData(size_t channel) const
 {
-    return m_buffer.data() + m_windowOffset;
+    return m_ring.GetData(channel, m_windowIndex);
 }
 
-size_t AudioCapture::GetWindowSize() const
+void AudioCapture::SetFraming(size_t frameNumSamples, size_t hopNumSamples)
 {
-    return m_windowSize;
+    m_frameNumSamples = frameNumSamples > 0 ? (std::min)(frameNumSamples, GetMaxFrameNumSamples()) : m_windowNumSamples;
+    m_hopNumSamples = hopNumSamples;
+
+    // bounded by the work one Capture() may cause and by what the ring holds behind the frame
+    m_maxNumFrames = 1;
+    if (m_hopNumSamples > 0)
+        m_maxNumFrames = (std::max)((size_t)1, (std::min)((size_t)32, (m_ring.GetCapacity() - m_frameNumSamples) / m_hopNumSamples));
+
+    // the first frame ends at the newest sample
+    m_nextFrameEnd = m_ring.GetWriteIndex();
+    m_captureIndex = m_nextFrameEnd;
+    m_numNewSamples = 0;
 }
 
-size_t AudioCapture::GetSampleRate() const
+size_t AudioCapture::GetFrameNumSamples() const
 {
-    return m_wfx->nSamplesPerSec;
+    return m_frameNumSamples;
 }
 
-size_t AudioCapture::GetSampleSize() const
+size_t AudioCapture::GetMaxFrameNumSamples() const
 {
-    return m_wfx->nBlockAlign / m_wfx->nChannels;
+    // the other half is for frames still being analyzed and what arrives in the meantime
+    return (std::max)(m_ring.GetCapacity() / 2, m_windowNumSamples);
 }
 
-size_t AudioCapture::GetWindowNumSamples() const
+size_t AudioCapture::GetHopSize() const
 {
-    return GetWindowSize() / GetSampleSize();
+    return m_hopNumSamples;
 }
 
-bool AudioCapture::DidDefaultDeviceChange()
+size_t AudioCapture::GetMaxNumFrames() const
 {
-    if (m_notificationClient->m_didDefaultDeviceChange)
-    {
-        m_notificationClient->m_didDefaultDeviceChange = false;
-        return true;
-    }
-    return false;
+    return m_maxNumFrames;
 }
 
-bool AudioCapture::InitializeDefaultDeviceCapture()
+size_t AudioCapture::GetNumFrames() const
 {
-    HRESULT hr;
-    size_t bufferSize;
+    return m_numFrames;
+}
 
-    hr = m_enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &m_device);
-    if (FAILED(hr))
-        goto fail;
+float const* AudioCapture::GetFrameData(size_t frame, size_t channel) const
+{
+    return m_ring.GetData(channel, m_frameIndex + frame * m_hopNumSamples);
+}
 
-    hr = m_device->Activate(IID_IAudioClient, CLSCTX_ALL, nullptr, (void**)&m_audioClient);
-    if (FAILED(hr))
-        goto fail;
+size_t AudioCapture::GetNumNewSamples() const
+{
+    return m_numNewSamples;
+}
 
-    hr = m_audioClient->GetMixFormat(&m_wfx);
-    if (FAILED(hr))
-        goto fail;
+bool AudioCapture::IsWindowSilent() const
+{
+    return m_isWindowSilent;
+}
 
-    if (!(m_wfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE &&
-        m_wfxt->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT &&
-        m_wfx->wBitsPerSample == 32 && m_wfxt->Samples.wValidBitsPerSample == 32))
-    {
-        OLECHAR guid[64];
+uint64_t AudioCapture::GetWindowDevicePosition() const
+{
+    return m_windowDevicePosition;
+}
 
-        std::cerr << "Unsupported audio format: " << m_wfx->wFormatTag;
-        if (m_wfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE && StringFromGUID2(m_wfxt->SubFormat, guid, 64))
-            std::wcerr
-                << ":" << guid
-                << ":" << m_wfxt->Samples.wValidBitsPerSample
-                << "/" << m_wfx->wBitsPerSample;
-        std::cerr << std::endl;
+std::chrono::steady_clock::time_point AudioCapture::GetWindowTime() const
+{
+    return m_windowTime;
+}
 
-        goto fail;
-    }
+uint64_t AudioCapture::GetNumGlitches() const
+{
+    return m_numGlitches.load(std::memory_order_relaxed);
+}
 
-    m_aux.resize(m_wfx->nChannels);
+size_t AudioCapture::GetWindowSize() const
+{
+    return m_windowNumSamples * GetSampleSize();
+}
 
-    hr = m_audioClient->Initialize(
-        AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK,
-        m_requestedCaptureDuration, 0, m_wfx, nullptr);
-    if (FAILED(hr))
-        goto fail;
+size_t AudioCapture::GetSampleRate() const
+{
+    return m_sampleRate;
+}
 
-    hr = m_audioClient->GetBufferSize(&m_numBufferFrames);
-    if (FAILED(hr))
-        goto fail;
+size_t AudioCapture::GetSampleSize() const
+{
+    return GetSampleFormatSize(m_sampleFormat);
+}
 
-    m_actualCaptureDuration = (REFERENCE_TIME)(REFTIMES_PER_SEC * (float)m_numBufferFrames / GetSampleRate());
+size_t AudioCapture::GetNumChannels() const
+{
+    return m_numChannels;
+}
 
-    hr = m_audioClient->GetService(IID_IAudioCaptureClient, (void**)&m_audioCaptureClient);
-    if (FAILED(hr))
-        goto fail;
+size_t AudioCapture::GetFrameSize() const
+{
+    return GetSampleSize() * GetNumChannels();
+}
 
-    hr = m_audioClient->Start();
-    if (FAILED(hr))
-        goto fail;
+size_t AudioCapture::GetWindowNumSamples() const
+{
+    return m_windowNumSamples;
+}
 
-    m_windowSize = (size_t)std::ceilf((float)m_windowDuration / REFTIMES_PER_SEC * GetSampleRate() * GetSampleSize());
-    m_windowOffset = 0;
+bool AudioCapture::DidDeviceChange()
+{
+    return false;
+}
 
-    bufferSize = m_windowSize * 2;
+bool AudioCapture::SetFormat(size_t sampleRate, size_t numChannels, SampleFormat sampleFormat)
+{
+    if (sampleRate == 0 || numChannels == 0)
+        return false;
 
-    m_buffer.resize(bufferSize, 0);
+    m_sampleRate = sampleRate;
+    m_numChannels = numChannels;
+    m_sampleFormat = sampleFormat;
 
-    return true;
+    m_convert = SelectConvertKernel(m_sampleFormat);
+    m_deinterleave = SelectDeinterleaveKernel(m_numChannels);
+    m_channelData.resize(m_numChannels);
 
-fail:
-    DestroyDefaultDeviceCapture();
-    return false;
-}
+    m_windowNumSamples = (size_t)std::ceil(m_windowDuration / 1000.f * m_sampleRate);
 
-void AudioCapture::DestroyDefaultDeviceCapture()
-{
-    if (m_audioClient)
-        m_audioClient->Stop();
-    if (m_audioCaptureClient)
-        m_audioCaptureClient->Release();
-    if (m_wfx)
-        CoTaskMemFree(m_wfx);
-    if (m_audioClient)
-        m_audioClient->Release();
-    if (m_device)
-        m_device->Release();
+    // two seconds of audio allow frames of up to a second that the render thread may still stall on for a while
+    if (!m_ring.Reset((std::max)(m_sampleRate * 2, m_windowNumSamples * 2), m_numChannels))
+        return false;
+
+    m_windowIndex = m_ring.GetWriteIndex() - m_windowNumSamples;
+    m_isWindowSilent = false;
+
+    m_frameIndex = m_windowIndex;
+    m_numFrames = 0;
+    SetFraming(0, 0);
+
+    m_isPacketTagged = false;
+    m_nextDevicePosition = 0;
+    m_nextPacketTime = std::chrono::steady_clock::now();
+    m_anchorSequence.store(0, std::memory_order_relaxed);
+
+    return true;
 }
 
-AudioCaptureNotify::AudioCaptureNotify()
-    : m_numRefs(1)
-    , m_didDefaultDeviceChange(false)
+void AudioCapture::TagPacket(uint64_t devicePosition, std::chrono::steady_clock::time_point captureTime)
 {
+    m_packetDevicePosition = devicePosition;
+    m_packetTime = captureTime;
+    m_isPacketTagged = true;
 }
 
-HRESULT STDMETHODCALLTYPE AudioCaptureNotify::QueryInterface(REFIID riid, void** ppvInterface)
+void AudioCapture::BeginPacket(size_t numFrames)
 {
-    if (riid == IID_IUnknown)
-    {
-        AddRef();
-        *ppvInterface = (IUnknown*)this;
-    }
-    else if (riid == IID_IMMNotificationClient)
-    {
-        AddRef();
-        *ppvInterface = (IMMNotificationClient*)this;
-    }
-    else
+    if (!m_isPacketTagged)
     {
-        *ppvInterface = nullptr;
-        return E_NOINTERFACE;
+        m_packetDevicePosition = m_nextDevicePosition;
+        m_packetTime = std::chrono::steady_clock::now() - std::chrono::nanoseconds((int64_t)numFrames * 1000000000 / (int64_t)m_sampleRate);
     }
-    return S_OK;
-}
+    m_isPacketTagged = false;
 
-ULONG STDMETHODCALLTYPE AudioCaptureNotify::AddRef()
-{
-    return InterlockedIncrement(&m_numRefs);
+    // the packet starts at the current write end of the ring
+    uint32_t sequence = m_anchorSequence.load(std::memory_order_relaxed);
+
+    m_anchorSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_anchorIndex.store(m_ring.GetWriteIndex(), std::memory_order_relaxed);
+    m_anchorDevicePosition.store(m_packetDevicePosition, std::memory_order_relaxed);
+    m_anchorTime.store(std::chrono::duration_cast<std::chrono::nanoseconds>(m_packetTime.time_since_epoch()).count(), std::memory_order_relaxed);
+
+    m_anchorSequence.store(sequence + 2, std::memory_order_release);
 }
 
-ULONG STDMETHODCALLTYPE AudioCaptureNotify::Release()
+void AudioCapture::EndPacket(size_t numFrames, size_t numFramesWritten)
 {
-    ULONG numRefs = InterlockedDecrement(&m_numRefs);
-    if (numRefs == 0)
-        delete this;
-    return numRefs;
+    // a full ring drops the end of the packet; the stream continues after what was kept, so the anchors stay
+    // true and a tagged packet after the drop fills the hole like any other gap
+    if (numFramesWritten < numFrames)
+        CountGlitch();
+
+    m_nextDevicePosition = m_packetDevicePosition + numFramesWritten;
+    m_nextPacketTime = m_packetTime + std::chrono::nanoseconds((int64_t)numFramesWritten * 1000000000 / (int64_t)m_sampleRate);
 }
 
-HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState)
+void AudioCapture::AddFrames(void const* data, size_t numFrames)
 {
-    return S_OK;
+    BeginPacket(numFrames);
+
+    float const* samples = static_cast<float const*>(data);
+
+    if (m_sampleFormat != SampleFormat::Float32)
+    {
+        m_converted.resize(numFrames * m_numChannels);
+        m_convert(data, m_converted.size(), m_converted.data());
+
+        samples = m_converted.data();
+    }
+
+    // split the whole packet straight into the per-channel rings
+    size_t numSamples = m_ring.BeginWrite(numFrames);
+
+    for (size_t channel = 0; channel < m_numChannels; ++channel)
+        m_channelData[channel] = m_ring.GetWriteData(channel);
+
+    m_deinterleave(samples, m_numChannels, numSamples, m_channelData.data());
+
+    m_ring.EndWrite(numSamples);
+
+    EndPacket(numFrames, numSamples);
 }
 
-HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnDeviceAdded(LPCWSTR pwstrDeviceId)
+void AudioCapture::AddSilence(size_t numFrames)
 {
-    return S_OK;
+    BeginPacket(numFrames);
+
+    EndPacket(numFrames, m_ring.WriteZeros(numFrames));
 }
 
-HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnDeviceRemoved(LPCWSTR pwstrDeviceId)
+void AudioCapture::CountGlitch()
 {
-    return S_OK;
+    m_numGlitches.fetch_add(1, std::memory_order_relaxed);
 }
 
-HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId)
+uint64_t AudioCapture::GetNextDevicePosition() const
 {
-    if (flow == eRender && role == eConsole)
-        m_didDefaultDeviceChange = true;
-
-    return S_OK;
+    return m_nextDevicePosition;
 }
 
-HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnPropertyValueChanged(LPCWSTR pwstrDeviceId, PROPERTYKEY const key)
+std::chrono::steady_clock::time_point AudioCapture::GetNextPacketTime() const
 {
-    return S_OK;
+    return m_nextPacketTime;
 }
@@ -1,23 +1,25 @@
 #pragma once
 
 #include "IInitializable.h"
-
-#include <Audioclient.h>
-#include <mmdeviceapi.h>
+#include "RingBuffer.h"
+#include "SampleConversion.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
 #include <vector>
 
-#define REFTIMES_PER_SEC 10000000
-#define REFTIMES_PER_MILLISEC 10000
-
-class AudioCaptureNotify;
-
 class AudioCapture : public IInitializable
 {
 public:
-    AudioCapture(REFERENCE_TIME windowDuration = 25 * REFTIMES_PER_MILLISEC);
+    // wasapi | file:<path> | raw:<rate>,<channels>,<format>:<path> | pipe[:<rate>,<channels>,<format>] | signal[:<frequency>]
+    static AudioCapture* Create(std::string const& source);
+
+    AudioCapture(float windowDuration = 25.f);
 
     AudioCapture(AudioCapture const&) = delete;
     AudioCapture(AudioCapture&&) = delete;
@@ -27,74 +29,114 @@ public:
 
     virtual ~AudioCapture() override;
 
+    bool Start();
+    void Stop();
+
     bool Capture();
 
-    float const* GetWindowData() const;
+    // planar window of the channel, valid until the next Capture()
+    float const* GetWindowData(size_t channel) const;
+
+    // With a hop size set, every Capture() exposes the analysis frames that completed since the previous one,
+    // each frameNumSamples long and hopNumSamples after the last, the window being the end of the newest.
+    // Without one (0) there is always exactly one frame, ending at the newest sample.
+    // Frames are at most GetMaxFrameNumSamples() long, 0 makes them as long as the window.
+    void SetFraming(size_t frameNumSamples, size_t hopNumSamples);
+    size_t GetFrameNumSamples() const;
+    size_t GetMaxFrameNumSamples() const;
+    size_t GetHopSize() const;
+    size_t GetMaxNumFrames() const;
+    size_t GetNumFrames() const;
+    float const* GetFrameData(size_t frame, size_t channel) const;
+    // samples that arrived between the previous Capture() and this one, the newest ones of the newest frame
+    size_t GetNumNewSamples() const;
+
+    // whether the whole window and every frame came from silent packets
+    bool IsWindowSilent() const;
+    // position in the device stream and capture time just past the newest frame of the window
+    uint64_t GetWindowDevicePosition() const;
+    std::chrono::steady_clock::time_point GetWindowTime() const;
+    // dropouts reported by the source since it was created
+    uint64_t GetNumGlitches() const;
     size_t GetWindowSize() const;
     size_t GetSampleRate() const;
     size_t GetSampleSize() const;
+    size_t GetNumChannels() const;
+    size_t GetFrameSize() const;
     size_t GetWindowNumSamples() const;
 
-    bool DidDefaultDeviceChange();
-    bool InitializeDefaultDeviceCapture();
-    void DestroyDefaultDeviceCapture();
+    virtual bool DidDeviceChange();
+    virtual bool InitializeDeviceCapture() = 0;
+    virtual void DestroyDeviceCapture() = 0;
 
-private:
-    bool Initialize() override;
-    void Destroy() override;
+protected:
+    // called on the capture thread: block until the source has data (or a timeout expires), then drain it
+    virtual void WaitForPackets() = 0;
+    virtual bool ReadPackets() = 0;
 
-    REFERENCE_TIME m_windowDuration;
+    bool SetFormat(size_t sampleRate, size_t numChannels, SampleFormat sampleFormat);
 
-    IMMDeviceEnumerator* m_enumerator;
-    AudioCaptureNotify* m_notificationClient;
+    // frames added without a tag continue the device stream from the previous packet, captured just now
+    void TagPacket(uint64_t devicePosition, std::chrono::steady_clock::time_point captureTime);
+    void AddFrames(void const* data, size_t numFrames);
+    void AddSilence(size_t numFrames);
+    void CountGlitch();
 
-    IMMDevice* m_device;
-    IAudioClient* m_audioClient;
-
-    union
-    {
-        WAVEFORMATEX* m_wfx;
-        WAVEFORMATEXTENSIBLE* m_wfxt;
-    };
-
-    REFERENCE_TIME m_requestedCaptureDuration;
-    UINT32 m_numBufferFrames;
-    REFERENCE_TIME m_actualCaptureDuration;
-
-    IAudioCaptureClient* m_audioCaptureClient;
-
-    std::vector<float> m_aux;
-    std::vector<float> m_buffer;
-
-    size_t m_windowSize;
-    size_t m_windowOffset;
-};
-
-class AudioCaptureNotify : public IMMNotificationClient
-{
-    friend class AudioCapture;
-
-public:
-    AudioCaptureNotify();
-
-    AudioCaptureNotify(AudioCaptureNotify const&) = delete;
-    AudioCaptureNotify(AudioCaptureNotify&&) = delete;
-
-    AudioCaptureNotify& operator=(AudioCaptureNotify const&) = delete;
-    AudioCaptureNotify& operator=(AudioCaptureNotify&&) = delete;
-
-    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvInterface) override;
-    ULONG STDMETHODCALLTYPE AddRef() override;
-    ULONG STDMETHODCALLTYPE Release() override;
-
-    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState) override;
-    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR pwstrDeviceId) override;
-    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR pwstrDeviceId) override;
-    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId) override;
-    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR pwstrDeviceId, PROPERTYKEY const key) override;
+    // where the frame following the newest one belongs in the device stream
+    uint64_t GetNextDevicePosition() const;
+    std::chrono::steady_clock::time_point GetNextPacketTime() const;
 
 private:
-    LONG m_numRefs;
-
-    bool volatile m_didDefaultDeviceChange;
+    void CaptureThread();
+
+    void BeginPacket(size_t numFrames);
+    // numFramesWritten of the packet's numFrames fit into the ring
+    void EndPacket(size_t numFrames, size_t numFramesWritten);
+
+    float m_windowDuration;
+
+    size_t m_sampleRate;
+    size_t m_numChannels;
+    SampleFormat m_sampleFormat;
+
+    ConvertKernel m_convert;
+    DeinterleaveKernel m_deinterleave;
+    std::vector<float> m_converted;
+    std::vector<float*> m_channelData;
+
+    RingBuffer m_ring;
+    std::thread m_captureThread;
+    std::atomic<bool> m_isCapturing;
+    std::atomic<bool> m_didCaptureFail;
+
+    size_t m_windowNumSamples;
+    size_t m_windowIndex;
+
+    size_t m_frameNumSamples;
+    size_t m_hopNumSamples;
+    size_t m_maxNumFrames;
+    size_t m_numFrames;
+    size_t m_frameIndex;
+    size_t m_nextFrameEnd;
+    size_t m_captureIndex;
+    size_t m_numNewSamples;
+
+    bool m_isWindowSilent;
+    uint64_t m_windowDevicePosition;
+    std::chrono::steady_clock::time_point m_windowTime;
+
+    // producer side timing of the packet being added and the one after it
+    bool m_isPacketTagged;
+    uint64_t m_packetDevicePosition;
+    std::chrono::steady_clock::time_point m_packetTime;
+    uint64_t m_nextDevicePosition;
+    std::chrono::steady_clock::time_point m_nextPacketTime;
+
+    // ring index, device position and time of the newest packet start, published under a sequence lock
+    std::atomic<uint32_t> m_anchorSequence;
+    std::atomic<size_t> m_anchorIndex;
+    std::atomic<uint64_t> m_anchorDevicePosition;
+    std::atomic<int64_t> m_anchorTime;
+
+    std::atomic<uint64_t> m_numGlitches;
 };
@@ -0,0 +1,397 @@
+#include "AudioCaptureFile.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <Windows.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <errno.h>
+
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifndef WAVE_FORMAT_PCM
+#define WAVE_FORMAT_PCM 0x0001
+#endif
+#ifndef WAVE_FORMAT_IEEE_FLOAT
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#endif
+#ifndef WAVE_FORMAT_EXTENSIBLE
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+#endif
+
+static uint16_t ReadLE16(uint8_t const* data)
+{
+    return (uint16_t)(data[0] | data[1] << 8);
+}
+
+static uint32_t ReadLE32(uint8_t const* data)
+{
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static bool SkipBytes(FILE* file, uint64_t numBytes)
+{
+    uint8_t scratch[256];
+
+    while (numBytes > 0)
+    {
+        size_t n = (size_t)(std::min)(numBytes, (uint64_t)sizeof(scratch));
+        if (fread(scratch, 1, n, file) != n)
+            return false;
+        numBytes -= n;
+    }
+    return true;
+}
+
+AudioCaptureFile::AudioCaptureFile(std::string const& path, float windowDuration)
+    : AudioCapture(windowDuration)
+    , m_path(path)
+    , m_isRaw(false)
+    , m_rawSampleRate()
+    , m_rawNumChannels()
+    , m_rawSampleFormat(SampleFormat::Float32)
+    , m_file()
+    , m_dataOffset()
+    , m_dataSize()
+    , m_dataRemaining()
+    , m_numBytesReady()
+    , m_isEndOfStream(false)
+    , m_numPacketBytes()
+    , m_numFramesPending()
+{
+    if (!Initialize())
+        std::cerr << "Could not initialize AudioCaptureFile" << std::endl;
+}
+
+AudioCaptureFile::AudioCaptureFile(std::string const& path, size_t sampleRate, size_t numChannels, SampleFormat sampleFormat, float windowDuration)
+    : AudioCapture(windowDuration)
+    , m_path(path)
+    , m_isRaw(true)
+    , m_rawSampleRate(sampleRate)
+    , m_rawNumChannels(numChannels)
+    , m_rawSampleFormat(sampleFormat)
+    , m_file()
+    , m_dataOffset()
+    , m_dataSize(UINT64_MAX)
+    , m_dataRemaining(UINT64_MAX)
+    , m_numBytesReady()
+    , m_isEndOfStream(false)
+    , m_numPacketBytes()
+    , m_numFramesPending()
+{
+    if (!Initialize())
+        std::cerr << "Could not initialize AudioCaptureFile" << std::endl;
+}
+
+AudioCaptureFile::~AudioCaptureFile()
+{
+    if (m_isInitialized)
+        Destroy();
+}
+
+bool AudioCaptureFile::Initialize()
+{
+    if (!InitializeDeviceCapture())
+        goto fail;
+
+    m_isInitialized = true;
+    return true;
+
+fail:
+    Destroy();
+    return false;
+}
+
+void AudioCaptureFile::Destroy()
+{
+    Stop();
+
+    DestroyDeviceCapture();
+}
+
+bool AudioCaptureFile::IsStandardInput() const
+{
+    return m_path == "-";
+}
+
+void AudioCaptureFile::WaitForPackets()
+{
+    if (!IsStandardInput() || m_isEndOfStream)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return;
+    }
+
+    // never block on an idle or stalled pipe, otherwise Stop() could not join the capture thread
+#ifdef _WIN32
+    DWORD numBytesAvailable;
+    if (!PeekNamedPipe(GetStdHandle(STD_INPUT_HANDLE), nullptr, 0, nullptr, &numBytesAvailable, nullptr))
+        m_numBytesReady = m_packet.size(); // not a pipe, or the writer closed it; ReadFile returns at once either way
+    else if ((m_numBytesReady = numBytesAvailable) == 0)
+        Sleep(1);
+#else
+    // a readable pipe hands over whatever it holds without blocking, up to the size asked for
+    pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+    m_numBytesReady = poll(&fd, 1, 10) > 0 ? m_packet.size() : 0;
+#endif
+}
+
+bool AudioCaptureFile::ReadPackets()
+{
+    if (IsStandardInput() && !m_isEndOfStream)
+        return ReadStream();
+
+    bool didRewind = false;
+
+    auto now = std::chrono::steady_clock::now();
+    m_numFramesPending += std::chrono::duration<double>(now - m_lastReadTime).count() * GetSampleRate();
+    m_lastReadTime = now;
+
+    // never catch up on more than a second of audio after a stall
+    if (m_numFramesPending > GetSampleRate())
+        m_numFramesPending = (double)GetSampleRate();
+
+    size_t numFrames = (size_t)m_numFramesPending;
+    m_numFramesPending -= numFrames;
+
+    while (numFrames > 0)
+    {
+        size_t numFramesToRead = (std::min)(numFrames, m_packet.size() / GetFrameSize());
+        numFramesToRead = (size_t)(std::min)((uint64_t)numFramesToRead, m_dataRemaining / GetFrameSize());
+
+        size_t numFramesRead = numFramesToRead > 0 ? fread(m_packet.data(), GetFrameSize(), numFramesToRead, m_file) : 0;
+
+        AddFrames(m_packet.data(), numFramesRead);
+
+        numFrames -= numFramesRead;
+        if (m_dataRemaining != UINT64_MAX)
+            m_dataRemaining -= numFramesRead * GetFrameSize();
+
+        if (numFramesRead < numFramesToRead || numFramesToRead == 0)
+        {
+            if (didRewind || !Rewind())
+            {
+                AddSilence(numFrames);
+                break;
+            }
+            didRewind = true;
+        }
+        else
+        {
+            didRewind = false;
+        }
+    }
+
+    return true;
+}
+
+bool AudioCaptureFile::ReadStream()
+{
+    if (m_numBytesReady == 0)
+        return true;
+
+    // only what is there, a writer stalling mid-packet must not block the capture thread
+    size_t numBytesToRead = (std::min)(m_numBytesReady, m_packet.size() - m_numPacketBytes);
+    numBytesToRead = (size_t)(std::min)((uint64_t)numBytesToRead, m_dataRemaining);
+
+    bool isEndOfStream = numBytesToRead == 0;
+    size_t numBytesRead = 0;
+
+    m_numBytesReady = 0;
+
+    if (!isEndOfStream)
+    {
+#ifdef _WIN32
+        DWORD numBytesReadWin32;
+        if (!ReadFile(GetStdHandle(STD_INPUT_HANDLE), m_packet.data() + m_numPacketBytes, (DWORD)numBytesToRead, &numBytesReadWin32, nullptr))
+            isEndOfStream = true;
+        else if ((numBytesRead = numBytesReadWin32) == 0)
+            isEndOfStream = true;
+#else
+        ptrdiff_t result = read(STDIN_FILENO, m_packet.data() + m_numPacketBytes, numBytesToRead);
+        if (result > 0)
+            numBytesRead = (size_t)result;
+        else if (result == 0 || (errno != EINTR && errno != EAGAIN))
+            isEndOfStream = true;
+#endif
+    }
+
+    if (m_dataRemaining != UINT64_MAX)
+        m_dataRemaining -= numBytesRead;
+
+    // whole frames go on, a partial one waits at the start of the packet for the rest of its bytes
+    m_numPacketBytes += numBytesRead;
+
+    size_t numFrames = m_numPacketBytes / GetFrameSize();
+    AddFrames(m_packet.data(), numFrames);
+
+    m_numPacketBytes -= numFrames * GetFrameSize();
+    std::memmove(m_packet.data(), m_packet.data() + numFrames * GetFrameSize(), m_numPacketBytes);
+
+    if (isEndOfStream)
+    {
+        m_isEndOfStream = true;
+        m_lastReadTime = std::chrono::steady_clock::now();
+    }
+
+    return true;
+}
+
+bool AudioCaptureFile::InitializeDeviceCapture()
+{
+    if (IsStandardInput())
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        // the samples are read past stdio, so it must not buffer any beyond the header
+        setvbuf(stdin, nullptr, _IONBF, 0);
+        m_file = stdin;
+    }
+    else
+    {
+        m_file = fopen(m_path.c_str(), "rb");
+    }
+
+    if (!m_file)
+    {
+        std::cerr << "Could not open " << m_path << std::endl;
+        goto fail;
+    }
+
+    if (m_isRaw)
+    {
+        if (!SetFormat(m_rawSampleRate, m_rawNumChannels, m_rawSampleFormat))
+            goto fail;
+    }
+    else if (!ReadWaveHeader())
+    {
+        goto fail;
+    }
+
+    m_dataOffset = IsStandardInput() ? -1 : ftell(m_file);
+
+    m_packet.resize((GetSampleRate() / 100 + 1) * GetFrameSize());
+
+    m_numBytesReady = 0;
+    m_isEndOfStream = false;
+    m_numPacketBytes = 0;
+
+    m_lastReadTime = std::chrono::steady_clock::now();
+    m_numFramesPending = 0.;
+
+    return true;
+
+fail:
+    DestroyDeviceCapture();
+    return false;
+}
+
+void AudioCaptureFile::DestroyDeviceCapture()
+{
+    if (m_file && m_file != stdin)
+        fclose(m_file);
+
+    m_file = nullptr;
+}
+
+bool AudioCaptureFile::ReadWaveHeader()
+{
+    uint8_t header[40];
+    size_t chunkSize;
+
+    if (fread(header, 1, 12, m_file) != 12 ||
+        std::memcmp(&header[0], "RIFF", 4) != 0 || std::memcmp(&header[8], "WAVE", 4) != 0)
+    {
+        std::cerr << "Not a WAV file: " << m_path << std::endl;
+        return false;
+    }
+
+    uint16_t formatTag = 0;
+    uint16_t numChannels = 0;
+    uint32_t sampleRate = 0;
+    uint16_t bitsPerSample = 0;
+
+    for (;;)
+    {
+        if (fread(header, 1, 8, m_file) != 8)
+        {
+            std::cerr << "Missing data chunk: " << m_path << std::endl;
+            return false;
+        }
+
+        chunkSize = ReadLE32(&header[4]);
+
+        if (std::memcmp(&header[0], "fmt ", 4) == 0)
+        {
+            size_t formatSize = (std::min)(chunkSize, sizeof(header));
+            if (formatSize < 16 || fread(header, 1, formatSize, m_file) != formatSize)
+                return false;
+
+            formatTag = ReadLE16(&header[0]);
+            numChannels = ReadLE16(&header[2]);
+            sampleRate = ReadLE32(&header[4]);
+            bitsPerSample = ReadLE16(&header[14]);
+
+            // the first two bytes of the extensible sub-format GUID hold the format tag
+            if (formatTag == WAVE_FORMAT_EXTENSIBLE && formatSize >= 40)
+                formatTag = ReadLE16(&header[24]);
+
+            if (!SkipBytes(m_file, chunkSize - formatSize + (chunkSize & 1)))
+                return false;
+        }
+        else if (std::memcmp(&header[0], "data", 4) == 0)
+        {
+            // streamed WAV files leave the size unset
+            m_dataSize = chunkSize == 0 || chunkSize == UINT32_MAX ? UINT64_MAX : chunkSize;
+            m_dataRemaining = m_dataSize;
+            break;
+        }
+        else if (!SkipBytes(m_file, chunkSize + (chunkSize & 1)))
+        {
+            return false;
+        }
+    }
+
+    SampleFormat sampleFormat;
+
+    if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 16)
+        sampleFormat = SampleFormat::Int16;
+    else if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 24)
+        sampleFormat = SampleFormat::Int24;
+    else if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 32)
+        sampleFormat = SampleFormat::Int32;
+    else if (formatTag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 32)
+        sampleFormat = SampleFormat::Float32;
+    else if (formatTag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 64)
+        sampleFormat = SampleFormat::Float64;
+    else
+    {
+        std::cerr << "Unsupported audio format: " << formatTag << ":" << bitsPerSample << std::endl;
+        return false;
+    }
+
+    return SetFormat(sampleRate, numChannels, sampleFormat);
+}
+
+bool AudioCaptureFile::Rewind()
+{
+    if (m_dataOffset < 0 || fseek(m_file, m_dataOffset, SEEK_SET) != 0)
+        return false;
+
+    m_dataRemaining = m_dataSize;
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "AudioCapture.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Streams a WAV or headerless PCM file in real time, looping at the end.
+// A path of "-" reads from standard input instead, as fast as the writer
+// supplies data, and falls back to real-time silence once it closes.
+class AudioCaptureFile : public AudioCapture
+{
+public:
+    AudioCaptureFile(std::string const& path, float windowDuration = 25.f);
+    AudioCaptureFile(std::string const& path, size_t sampleRate, size_t numChannels, SampleFormat sampleFormat, float windowDuration = 25.f);
+
+    AudioCaptureFile(AudioCaptureFile const&) = delete;
+    AudioCaptureFile(AudioCaptureFile&&) = delete;
+
+    AudioCaptureFile& operator=(AudioCaptureFile const&) = delete;
+    AudioCaptureFile& operator=(AudioCaptureFile&&) = delete;
+
+    virtual ~AudioCaptureFile() override;
+
+    bool InitializeDeviceCapture() override;
+    void DestroyDeviceCapture() override;
+
+protected:
+    void WaitForPackets() override;
+    bool ReadPackets() override;
+
+private:
+    bool Initialize() override;
+    void Destroy() override;
+
+    bool IsStandardInput() const;
+
+    bool ReadWaveHeader();
+    bool ReadStream();
+    bool Rewind();
+
+    std::string m_path;
+
+    bool m_isRaw;
+    size_t m_rawSampleRate;
+    size_t m_rawNumChannels;
+    SampleFormat m_rawSampleFormat;
+
+    FILE* m_file;
+    long m_dataOffset;
+    uint64_t m_dataSize;
+    uint64_t m_dataRemaining;
+
+    // bytes standard input can hand over without blocking
+    size_t m_numBytesReady;
+    bool m_isEndOfStream;
+
+    std::vector<uint8_t> m_packet;
+    // bytes of a partial frame carried over at the start of m_packet
+    size_t m_numPacketBytes;
+
+    std::chrono::steady_clock::time_point m_lastReadTime;
+    double m_numFramesPending;
+};
@@ -0,0 +1,13 @@
+#include "AudioCapturePipe.h"
+
+#include <stddef.h>
+
+AudioCapturePipe::AudioCapturePipe(float windowDuration)
+    : AudioCaptureFile("-", windowDuration)
+{
+}
+
+AudioCapturePipe::AudioCapturePipe(size_t sampleRate, size_t numChannels, SampleFormat sampleFormat, float windowDuration)
+    : AudioCaptureFile("-", sampleRate, numChannels, sampleFormat, windowDuration)
+{
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "AudioCaptureFile.h"
+
+#include <stddef.h>
+
+// Streams a WAV or headerless PCM stream from standard input, e.g. from a decoder or a bench harness.
+class AudioCapturePipe : public AudioCaptureFile
+{
+public:
+    AudioCapturePipe(float windowDuration = 25.f);
+    AudioCapturePipe(size_t sampleRate, size_t numChannels, SampleFormat sampleFormat, float windowDuration = 25.f);
+
+    AudioCapturePipe(AudioCapturePipe const&) = delete;
+    AudioCapturePipe(AudioCapturePipe&&) = delete;
+
+    AudioCapturePipe& operator=(AudioCapturePipe const&) = delete;
+    AudioCapturePipe& operator=(AudioCapturePipe&&) = delete;
+
+    virtual ~AudioCapturePipe() override = default;
+};
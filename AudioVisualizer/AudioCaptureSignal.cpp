@@ -0,0 +1,122 @@
+#include "AudioCaptureSignal.h"
+
+#include <stddef.h>
+
+#include <cmath>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#define SIGNAL_NUM_CHANNELS 2
+#define SIGNAL_AMPLITUDE 0.5
+#define SWEEP_FREQUENCY_LOW 20.
+#define SWEEP_FREQUENCY_HIGH 20000.
+#define SWEEP_DURATION 10.
+
+AudioCaptureSignal::AudioCaptureSignal(float frequency, size_t sampleRate, float windowDuration)
+    : AudioCapture(windowDuration)
+    , m_frequency(frequency)
+    , m_signalSampleRate(sampleRate)
+    , m_phase()
+    , m_sweepPosition()
+    , m_numFramesPending()
+{
+    if (!Initialize())
+        std::cerr << "Could not initialize AudioCaptureSignal" << std::endl;
+}
+
+AudioCaptureSignal::~AudioCaptureSignal()
+{
+    if (m_isInitialized)
+        Destroy();
+}
+
+bool AudioCaptureSignal::Initialize()
+{
+    if (!InitializeDeviceCapture())
+        goto fail;
+
+    m_isInitialized = true;
+    return true;
+
+fail:
+    Destroy();
+    return false;
+}
+
+void AudioCaptureSignal::Destroy()
+{
+    Stop();
+
+    DestroyDeviceCapture();
+}
+
+void AudioCaptureSignal::WaitForPackets()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+bool AudioCaptureSignal::ReadPackets()
+{
+    double const twoPi = 2. * 3.14159265358979323846;
+    size_t const sweepLength = (size_t)(SWEEP_DURATION * GetSampleRate());
+
+    auto now = std::chrono::steady_clock::now();
+    m_numFramesPending += std::chrono::duration<double>(now - m_lastReadTime).count() * GetSampleRate();
+    m_lastReadTime = now;
+
+    if (m_numFramesPending > GetSampleRate())
+        m_numFramesPending = (double)GetSampleRate();
+
+    size_t numFrames = (size_t)m_numFramesPending;
+    m_numFramesPending -= numFrames;
+
+    while (numFrames > 0)
+    {
+        size_t numFramesPacket = (std::min)(numFrames, m_packet.size() / SIGNAL_NUM_CHANNELS);
+
+        for (size_t i = 0; i < numFramesPacket; ++i)
+        {
+            double frequency = m_frequency;
+            if (frequency <= 0.f)
+            {
+                frequency = SWEEP_FREQUENCY_LOW * std::pow(SWEEP_FREQUENCY_HIGH / SWEEP_FREQUENCY_LOW, (double)m_sweepPosition / sweepLength);
+                m_sweepPosition = (m_sweepPosition + 1) % sweepLength;
+            }
+
+            float sample = (float)(SIGNAL_AMPLITUDE * std::sin(m_phase));
+
+            m_phase += twoPi * frequency / GetSampleRate();
+            if (m_phase >= twoPi)
+                m_phase -= twoPi;
+
+            for (size_t j = 0; j < SIGNAL_NUM_CHANNELS; ++j)
+                m_packet[i * SIGNAL_NUM_CHANNELS + j] = sample;
+        }
+
+        AddFrames(m_packet.data(), numFramesPacket);
+
+        numFrames -= numFramesPacket;
+    }
+
+    return true;
+}
+
+bool AudioCaptureSignal::InitializeDeviceCapture()
+{
+    if (!SetFormat(m_signalSampleRate, SIGNAL_NUM_CHANNELS, SampleFormat::Float32))
+        return false;
+
+    m_packet.resize((GetSampleRate() / 100 + 1) * SIGNAL_NUM_CHANNELS);
+
+    m_lastReadTime = std::chrono::steady_clock::now();
+    m_numFramesPending = 0.;
+
+    return true;
+}
+
+void AudioCaptureSignal::DestroyDeviceCapture()
+{
+}
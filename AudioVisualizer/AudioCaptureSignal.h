@@ -0,0 +1,46 @@
+#pragma once
+
+#include "AudioCapture.h"
+
+#include <stddef.h>
+
+#include <chrono>
+#include <vector>
+
+// Generates a deterministic stereo test signal in real time: a sine tone at
+// the given frequency, or a repeating logarithmic sweep when it is zero.
+class AudioCaptureSignal : public AudioCapture
+{
+public:
+    AudioCaptureSignal(float frequency = 440.f, size_t sampleRate = 48000, float windowDuration = 25.f);
+
+    AudioCaptureSignal(AudioCaptureSignal const&) = delete;
+    AudioCaptureSignal(AudioCaptureSignal&&) = delete;
+
+    AudioCaptureSignal& operator=(AudioCaptureSignal const&) = delete;
+    AudioCaptureSignal& operator=(AudioCaptureSignal&&) = delete;
+
+    virtual ~AudioCaptureSignal() override;
+
+    bool InitializeDeviceCapture() override;
+    void DestroyDeviceCapture() override;
+
+protected:
+    void WaitForPackets() override;
+    bool ReadPackets() override;
+
+private:
+    bool Initialize() override;
+    void Destroy() override;
+
+    float m_frequency;
+    size_t m_signalSampleRate;
+
+    double m_phase;
+    size_t m_sweepPosition;
+
+    std::vector<float> m_packet;
+
+    std::chrono::steady_clock::time_point m_lastReadTime;
+    double m_numFramesPending;
+};
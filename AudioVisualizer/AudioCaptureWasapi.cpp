@@ -0,0 +1,395 @@
+#include "AudioCaptureWasapi.h"
+
+#include <Audioclient.h>
+#include <mmdeviceapi.h>
+#include <mmsystem.h>
+#include <Windows.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+CLSID const CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
+IID const IID_IMMDeviceEnumerator = __uuidof(IMMDeviceEnumerator);
+IID const IID_IMMNotificationClient = __uuidof(IMMNotificationClient);
+IID const IID_IAudioClient = __uuidof(IAudioClient);
+IID const IID_IAudioCaptureClient = __uuidof(IAudioCaptureClient);
+
+// QPC positions from GetBuffer are in 100-nanosecond units
+static std::chrono::steady_clock::time_point ToSteadyClock(UINT64 qpcPosition)
+{
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    auto now = std::chrono::steady_clock::now();
+
+    // split to keep the multiplication from overflowing
+    UINT64 qpcNow = counter.QuadPart / frequency.QuadPart * REFTIMES_PER_SEC +
+        counter.QuadPart % frequency.QuadPart * REFTIMES_PER_SEC / frequency.QuadPart;
+
+    return now - std::chrono::nanoseconds((INT64)(qpcNow - qpcPosition) * 100);
+}
+
+static bool GetSampleFormat(WAVEFORMATEX const* wfx, SampleFormat& sampleFormat)
+{
+    WAVEFORMATEXTENSIBLE const* wfxt = (WAVEFORMATEXTENSIBLE const*)wfx;
+
+    bool isPcm = wfx->wFormatTag == WAVE_FORMAT_PCM;
+    bool isFloat = wfx->wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+
+    if (wfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE)
+    {
+        isPcm = wfxt->SubFormat == KSDATAFORMAT_SUBTYPE_PCM;
+        isFloat = wfxt->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+    }
+
+    // the container size is what matters, valid bits narrower than it are left-justified
+    if (isPcm && wfx->wBitsPerSample == 16)
+        sampleFormat = SampleFormat::Int16;
+    else if (isPcm && wfx->wBitsPerSample == 24)
+        sampleFormat = SampleFormat::Int24;
+    else if (isPcm && wfx->wBitsPerSample == 32)
+        sampleFormat = SampleFormat::Int32;
+    else if (isFloat && wfx->wBitsPerSample == 32)
+        sampleFormat = SampleFormat::Float32;
+    else if (isFloat && wfx->wBitsPerSample == 64)
+        sampleFormat = SampleFormat::Float64;
+    else
+        return false;
+
+    return true;
+}
+
+AudioCaptureWasapi::AudioCaptureWasapi(float windowDuration)
+    : AudioCapture(windowDuration)
+    , m_enumerator()
+    , m_notificationClient()
+    , m_device()
+    , m_audioClient()
+    , m_wfx()
+    , m_requestedCaptureDuration(REFTIMES_PER_SEC)
+    , m_devicePeriod(10)
+    , m_captureEvent()
+    , m_audioCaptureClient()
+    , m_hasPacket(false)
+    , m_isPaddingIdle(false)
+{
+    if (!Initialize())
+        std::cerr << "Could not initialize AudioCaptureWasapi" << std::endl;
+}
+
+AudioCaptureWasapi::~AudioCaptureWasapi()
+{
+    if (m_isInitialized)
+        Destroy();
+}
+
+bool AudioCaptureWasapi::Initialize()
+{
+    HRESULT hr;
+
+    hr = CoCreateInstance(
+        CLSID_MMDeviceEnumerator, nullptr, CLSCTX_ALL,
+        IID_IMMDeviceEnumerator, (LPVOID*)&m_enumerator);
+    if (FAILED(hr))
+        goto fail;
+
+    m_notificationClient = new AudioCaptureNotify();
+
+    hr = m_enumerator->RegisterEndpointNotificationCallback(m_notificationClient);
+    if (FAILED(hr))
+        goto fail;
+
+    if (!InitializeDeviceCapture())
+        goto fail;
+
+    m_isInitialized = true;
+    return true;
+
+fail:
+    Destroy();
+    return false;
+}
+
+void AudioCaptureWasapi::Destroy()
+{
+    Stop();
+
+    DestroyDeviceCapture();
+
+    if (m_notificationClient)
+        m_enumerator->UnregisterEndpointNotificationCallback(m_notificationClient);
+    if (m_enumerator)
+        m_enumerator->Release();
+}
+
+void AudioCaptureWasapi::WaitForPackets()
+{
+    // loopback streams only signal while something is playing, so time out to keep padding with silence
+    WaitForSingleObject(m_captureEvent, m_devicePeriod);
+}
+
+bool AudioCaptureWasapi::ReadPackets()
+{
+    HRESULT hr;
+    UINT32 numFramesInNextPacket;
+    UINT32 numFramesAvailable;
+    BYTE* data;
+    DWORD flags;
+    UINT64 devicePosition;
+    UINT64 qpcPosition;
+
+    hr = m_audioCaptureClient->GetNextPacketSize(&numFramesInNextPacket);
+    if (FAILED(hr))
+        return false;
+
+    if (numFramesInNextPacket == 0)
+    {
+        // loopback delivers nothing while the endpoint is idle, so keep time with silence; packets still
+        // on their way are up to a couple of periods late and must not land behind made-up frames
+        auto overdue = std::chrono::steady_clock::now() - GetNextPacketTime() - std::chrono::milliseconds(m_devicePeriod * 2);
+
+        if (overdue.count() > 0)
+        {
+            size_t numFrames = (size_t)(std::chrono::duration<double>(overdue).count() * GetSampleRate());
+
+            TagPacket(GetNextDevicePosition(), GetNextPacketTime());
+            AddSilence((std::min)(numFrames, GetSampleRate()));
+
+            m_isPaddingIdle = true;
+        }
+    }
+
+    while (numFramesInNextPacket > 0)
+    {
+        hr = m_audioCaptureClient->GetBuffer(&data, &numFramesAvailable, &flags, &devicePosition, &qpcPosition);
+        if (FAILED(hr))
+            return false;
+
+        // the very first packet of a stream is always flagged, and so is the first after playback resumes from
+        // idle, whose gap the silence above already covered up to the couple of periods it holds back; only
+        // frames lost beyond that are a glitch
+        UINT64 numFramesPadded = m_isPaddingIdle ? (UINT64)GetSampleRate() * m_devicePeriod * 3 / 1000 : 0;
+
+        if ((flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) && m_hasPacket && devicePosition > GetNextDevicePosition() + numFramesPadded)
+            CountGlitch();
+
+        auto captureTime = flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR
+            ? std::chrono::steady_clock::now()
+            : ToSteadyClock(qpcPosition);
+
+        // frames the device skipped past are filled in so the window keeps its place in time;
+        // a position behind the expected one just realigns the stream
+        if (m_hasPacket && devicePosition > GetNextDevicePosition())
+        {
+            UINT64 numFramesMissing = (std::min)(devicePosition - GetNextDevicePosition(), (UINT64)GetSampleRate());
+
+            TagPacket(devicePosition - numFramesMissing,
+                captureTime - std::chrono::nanoseconds((INT64)numFramesMissing * 1000000000 / (INT64)GetSampleRate()));
+            AddSilence((size_t)numFramesMissing);
+        }
+
+        m_hasPacket = true;
+        m_isPaddingIdle = false;
+
+        TagPacket(devicePosition, captureTime);
+
+        // silent packets may hold garbage and need no conversion anyway
+        if (flags & AUDCLNT_BUFFERFLAGS_SILENT)
+            AddSilence(numFramesAvailable);
+        else
+            AddFrames(data, numFramesAvailable);
+
+        hr = m_audioCaptureClient->ReleaseBuffer(numFramesAvailable);
+        if (FAILED(hr))
+            return false;
+
+        hr = m_audioCaptureClient->GetNextPacketSize(&numFramesInNextPacket);
+        if (FAILED(hr))
+            return false;
+    }
+
+    return true;
+}
+
+bool AudioCaptureWasapi::DidDeviceChange()
+{
+    if (m_notificationClient->m_didDefaultDeviceChange)
+    {
+        m_notificationClient->m_didDefaultDeviceChange = false;
+        return true;
+    }
+    return false;
+}
+
+bool AudioCaptureWasapi::InitializeDeviceCapture()
+{
+    HRESULT hr;
+    REFERENCE_TIME devicePeriod;
+    SampleFormat sampleFormat;
+
+    hr = m_enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &m_device);
+    if (FAILED(hr))
+        goto fail;
+
+    hr = m_device->Activate(IID_IAudioClient, CLSCTX_ALL, nullptr, (void**)&m_audioClient);
+    if (FAILED(hr))
+        goto fail;
+
+    hr = m_audioClient->GetMixFormat(&m_wfx);
+    if (FAILED(hr))
+        goto fail;
+
+    if (!GetSampleFormat(m_wfx, sampleFormat))
+    {
+        OLECHAR guid[64];
+
+        std::cerr << "Unsupported audio format: " << m_wfx->wFormatTag;
+        if (m_wfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE && StringFromGUID2(m_wfxt->SubFormat, guid, 64))
+            std::wcerr
+                << ":" << guid
+                << ":" << m_wfxt->Samples.wValidBitsPerSample
+                << "/" << m_wfx->wBitsPerSample;
+        std::cerr << std::endl;
+
+        goto fail;
+    }
+
+    if (!SetFormat(m_wfx->nSamplesPerSec, m_wfx->nChannels, sampleFormat))
+        goto fail;
+
+    hr = m_audioClient->Initialize(
+        AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+        m_requestedCaptureDuration, 0, m_wfx, nullptr);
+    if (FAILED(hr))
+        goto fail;
+
+    m_captureEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!m_captureEvent)
+        goto fail;
+
+    hr = m_audioClient->SetEventHandle(m_captureEvent);
+    if (FAILED(hr))
+        goto fail;
+
+    hr = m_audioClient->GetDevicePeriod(&devicePeriod, nullptr);
+    if (SUCCEEDED(hr) && devicePeriod >= REFTIMES_PER_MILLISEC)
+        m_devicePeriod = (DWORD)(devicePeriod / REFTIMES_PER_MILLISEC);
+
+    hr = m_audioClient->GetBufferSize(&m_numBufferFrames);
+    if (FAILED(hr))
+        goto fail;
+
+    m_actualCaptureDuration = (REFERENCE_TIME)(REFTIMES_PER_SEC * (float)m_numBufferFrames / GetSampleRate());
+
+    hr = m_audioClient->GetService(IID_IAudioCaptureClient, (void**)&m_audioCaptureClient);
+    if (FAILED(hr))
+        goto fail;
+
+    m_hasPacket = false;
+    m_isPaddingIdle = false;
+
+    hr = m_audioClient->Start();
+    if (FAILED(hr))
+        goto fail;
+
+    return true;
+
+fail:
+    DestroyDeviceCapture();
+    return false;
+}
+
+void AudioCaptureWasapi::DestroyDeviceCapture()
+{
+    if (m_audioClient)
+        m_audioClient->Stop();
+    if (m_audioCaptureClient)
+        m_audioCaptureClient->Release();
+    if (m_wfx)
+        CoTaskMemFree(m_wfx);
+    if (m_audioClient)
+        m_audioClient->Release();
+    if (m_device)
+        m_device->Release();
+    if (m_captureEvent)
+        CloseHandle(m_captureEvent);
+
+    m_captureEvent = nullptr;
+    m_audioCaptureClient = nullptr;
+    m_wfx = nullptr;
+    m_audioClient = nullptr;
+    m_device = nullptr;
+}
+
+AudioCaptureNotify::AudioCaptureNotify()
+    : m_numRefs(1)
+    , m_didDefaultDeviceChange(false)
+{
+}
+
+HRESULT STDMETHODCALLTYPE AudioCaptureNotify::QueryInterface(REFIID riid, void** ppvInterface)
+{
+    if (riid == IID_IUnknown)
+    {
+        AddRef();
+        *ppvInterface = (IUnknown*)this;
+    }
+    else if (riid == IID_IMMNotificationClient)
+    {
+        AddRef();
+        *ppvInterface = (IMMNotificationClient*)this;
+    }
+    else
+    {
+        *ppvInterface = nullptr;
+        return E_NOINTERFACE;
+    }
+    return S_OK;
+}
+
+ULONG STDMETHODCALLTYPE AudioCaptureNotify::AddRef()
+{
+    return InterlockedIncrement(&m_numRefs);
+}
+
+ULONG STDMETHODCALLTYPE AudioCaptureNotify::Release()
+{
+    ULONG numRefs = InterlockedDecrement(&m_numRefs);
+    if (numRefs == 0)
+        delete this;
+    return numRefs;
+}
+
+HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState)
+{
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnDeviceAdded(LPCWSTR pwstrDeviceId)
+{
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnDeviceRemoved(LPCWSTR pwstrDeviceId)
+{
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId)
+{
+    if (flow == eRender && role == eConsole)
+        m_didDefaultDeviceChange = true;
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE AudioCaptureNotify::OnPropertyValueChanged(LPCWSTR pwstrDeviceId, PROPERTYKEY const key)
+{
+    return S_OK;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "AudioCapture.h"
+
+#include <Audioclient.h>
+#include <mmdeviceapi.h>
+
+#define REFTIMES_PER_SEC 10000000
+#define REFTIMES_PER_MILLISEC 10000
+
+class AudioCaptureNotify;
+
+class AudioCaptureWasapi : public AudioCapture
+{
+public:
+    AudioCaptureWasapi(float windowDuration = 25.f);
+
+    AudioCaptureWasapi(AudioCaptureWasapi const&) = delete;
+    AudioCaptureWasapi(AudioCaptureWasapi&&) = delete;
+
+    AudioCaptureWasapi& operator=(AudioCaptureWasapi const&) = delete;
+    AudioCaptureWasapi& operator=(AudioCaptureWasapi&&) = delete;
+
+    virtual ~AudioCaptureWasapi() override;
+
+    bool DidDeviceChange() override;
+    bool InitializeDeviceCapture() override;
+    void DestroyDeviceCapture() override;
+
+protected:
+    void WaitForPackets() override;
+    bool ReadPackets() override;
+
+private:
+    bool Initialize() override;
+    void Destroy() override;
+
+    IMMDeviceEnumerator* m_enumerator;
+    AudioCaptureNotify* m_notificationClient;
+
+    IMMDevice* m_device;
+    IAudioClient* m_audioClient;
+
+    union
+    {
+        WAVEFORMATEX* m_wfx;
+        WAVEFORMATEXTENSIBLE* m_wfxt;
+    };
+
+    REFERENCE_TIME m_requestedCaptureDuration;
+    UINT32 m_numBufferFrames;
+    REFERENCE_TIME m_actualCaptureDuration;
+    DWORD m_devicePeriod;
+
+    HANDLE m_captureEvent;
+    IAudioCaptureClient* m_audioCaptureClient;
+
+    // whether the stream has delivered anything since it was started, positions before that mean nothing
+    bool m_hasPacket;
+    // silence has been standing in for an idle endpoint since the last packet
+    bool m_isPaddingIdle;
+};
+
+class AudioCaptureNotify : public IMMNotificationClient
+{
+    friend class AudioCaptureWasapi;
+
+public:
+    AudioCaptureNotify();
+
+    AudioCaptureNotify(AudioCaptureNotify const&) = delete;
+    AudioCaptureNotify(AudioCaptureNotify&&) = delete;
+
+    AudioCaptureNotify& operator=(AudioCaptureNotify const&) = delete;
+    AudioCaptureNotify& operator=(AudioCaptureNotify&&) = delete;
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvInterface) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState) override;
+    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR pwstrDeviceId) override;
+    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR pwstrDeviceId) override;
+    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId) override;
+    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR pwstrDeviceId, PROPERTYKEY const key) override;
+
+private:
+    LONG m_numRefs;
+
+    bool volatile m_didDefaultDeviceChange;
+};
@@ -8,21 +8,100 @@
 #include <stddef.h>
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <vector>
 
-static inline float Hann(float x, size_t i, size_t n)
+static bool IsSmooth(size_t size)
 {
-    return x * 0.5f * (1.f - std::cosf(2.f * (float)M_PI * i / n));
+    size_t const factors[] = { 2, 3, 5 };
+
+    for (size_t factor : factors)
+    {
+        while (size % factor == 0)
+            size /= factor;
+    }
+    return size == 1;
+}
+
+static size_t RoundFFTSize(size_t size, FFTSizeRounding rounding)
+{
+    switch (rounding)
+    {
+    case FFTSizeRounding::Smooth:
+        while (!IsSmooth(size))
+            ++size;
+        return size;
+    case FFTSizeRounding::PowerOfTwo:
+    {
+        size_t powerOfTwo = 1;
+        while (powerOfTwo < size)
+            powerOfTwo *= 2;
+        return powerOfTwo;
+    }
+    default:
+        return size;
+    }
 }
 
-AudioTransform::AudioTransform(AudioCapture* capture, float decibelCutoff)
+static size_t RoundFFTSizeDown(size_t size, FFTSizeRounding rounding)
+{
+    switch (rounding)
+    {
+    case FFTSizeRounding::Smooth:
+        while (!IsSmooth(size))
+            --size;
+        return size;
+    case FFTSizeRounding::PowerOfTwo:
+    {
+        size_t powerOfTwo = 1;
+        while (powerOfTwo * 2 <= size)
+            powerOfTwo *= 2;
+        return powerOfTwo;
+    }
+    default:
+        return size;
+    }
+}
+
+// what the constant-Q bins cover, the lowest frequency only if frames can get long enough
+static float const s_constantQFrequencyLow = 20.f;
+static float const s_constantQFrequencyHigh = 20000.f;
+
+// what the perceptual bands cover, up to the Nyquist frequency
+static float const s_perceptualFrequencyLow = 20.f;
+static float const s_perceptualFrequencyHigh = 20000.f;
+
+// centers of the lowest and highest sliding DFT bands
+static float const s_bandFrequencyLow = 40.f;
+static float const s_bandFrequencyHigh = 16000.f;
+
+AudioTransform::AudioTransform(AudioCapture* capture, FFTPlanCache* fftPlanCache, float decibelCutoff)
     : m_audioCapture(capture)
+    , m_fftPlanCache(fftPlanCache)
     , m_decibelMode(true)
     , m_decibelCutoff(decibelCutoff)
+    , m_analysisMode(AnalysisMode::FFT)
+    , m_binsPerOctave(12)
+    , m_crossoverLow(250.f)
+    , m_crossoverHigh(2500.f)
+    , m_numBands(16)
+    , m_numChannels()
+    , m_fftSize()
+    , m_spectrumSize()
+    , m_fftSizeRounding(FFTSizeRounding::Smooth)
+    , m_zeroPadding(1)
+    , m_overlap(0.f)
+    , m_aggregation(SpectrumAggregation::Latest)
     , m_fftInput()
     , m_fftOutput()
-    , m_fftPlan()
+    , m_analysisOutput()
+    , m_powerKernel(SelectPowerKernel())
+    , m_decibelKernel(SelectDecibelKernel())
+    , m_magnitudeKernel(SelectMagnitudeKernel())
+    , m_perceptualScale(PerceptualScale::None)
+    , m_numPerceptualBands(40)
+    , m_areSpectraSilent(false)
 {
     if (!Initialize())
         std::cerr << "Could not initialize AudioTransform" << std::endl;
@@ -54,47 +133,293 @@ void AudioTransform::Destroy()
 
 void AudioTransform::Transform()
 {
-    std::copy(m_audioCapture->GetWindowData(), m_audioCapture->GetWindowData() + m_audioCapture->GetWindowNumSamples(), m_fftInput);
+    // a silent window transforms to zeros in every mode, so skip the work and keep what is already there
+    if (m_audioCapture->IsWindowSilent())
+    {
+        if (!m_areSpectraSilent)
+        {
+            std::fill(m_spectra.begin(), m_spectra.end(), 0.f);
+            std::fill(m_perceptualSpectra.begin(), m_perceptualSpectra.end(), 0.f);
+            m_areSpectraSilent = true;
+        }
 
-    for (size_t i = 0; i < m_audioCapture->GetWindowNumSamples(); ++i)
-        m_fftInput[i] = Hann(m_fftInput[i], i, m_audioCapture->GetWindowNumSamples());
+        // the sliding bands and the filters miss what arrives meanwhile and have to start over
+        m_slidingDFT.Restart();
+        m_filterbank.Restart();
+        return;
+    }
 
-    fftwf_execute(m_fftPlan);
+    size_t numFrames = m_audioCapture->GetNumFrames();
 
-    // calculate magnitudes
-    for (size_t i = 0; i < m_spectrum.size(); ++i)
-        m_spectrum[i] = std::sqrtf(m_fftOutput[i][0] * m_fftOutput[i][0] + m_fftOutput[i][1] * m_fftOutput[i][1]);
+    // no hop completed yet, the previous spectra are still the newest
+    if (numFrames == 0)
+        return;
 
-    float max = *std::max_element(m_spectrum.begin(), m_spectrum.end());
+    m_areSpectraSilent = false;
 
-    if (max > 1.f)
+    // the filters take every sample that arrived and write the spectra themselves
+    if (m_analysisMode == AnalysisMode::Filterbank)
     {
-        // normalize
-        for (size_t i = 0; i < m_spectrum.size(); ++i)
-            m_spectrum[i] /= max;
+        size_t frameNumSamples = m_audioCapture->GetFrameNumSamples();
+        size_t numNewSamples = (std::min)(m_audioCapture->GetNumNewSamples(), frameNumSamples);
+
+        for (size_t channel = 0; channel < m_numChannels; ++channel)
+            m_frameData[channel] = m_audioCapture->GetFrameData(0, channel) + frameNumSamples - numNewSamples;
+
+        m_filterbank.Update(m_frameData.data(), numNewSamples, m_spectra.data(), m_spectraMax.data());
+
+        FinishSpectra();
+        return;
     }
 
-    if (m_decibelMode)
+    size_t firstFrame = m_aggregation == SpectrumAggregation::Latest ? numFrames - 1 : 0;
+    size_t numBatchFrames = numFrames - firstFrame;
+
+    // a plan the planner has not got to yet leaves the previous spectra in place
+    if ((m_fftSize > 0 && !m_fftPlans[numBatchFrames]->Get()) ||
+        (m_analysisMode == AnalysisMode::MultiResolution && !m_multiResolution.IsPlanned()))
+        return;
+
+    // the multi-resolution bands run transforms of their own, the sliding DFT bands none
+    if (m_fftSize > 0)
     {
-        // convert to decibels
-        for (size_t i = 0; i < m_spectrum.size(); ++i)
+        // windows straight out of the capture rings, no intermediate copy; the padding past them stays zero
+        for (size_t frame = 0; frame < numBatchFrames; ++frame)
         {
-            float decibels = 20.f * std::log10f(m_spectrum[i]);
+            for (size_t channel = 0; channel < m_numChannels; ++channel)
+            {
+                float const* data = m_audioCapture->GetFrameData(firstFrame + frame, channel);
+                float* input = m_fftInput + (frame * m_numChannels + channel) * m_fftSize;
 
-            m_spectrum[i] = (decibels + std::fabsf(m_decibelCutoff)) / std::fabsf(m_decibelCutoff);
-            m_spectrum[i] = std::fmaxf(m_spectrum[i], 0.f);
+                // the constant-Q kernels bring their own windows
+                if (m_analysisMode == AnalysisMode::ConstantQ)
+                    std::copy(data, data + m_fftSize, input);
+                else
+                    m_windowFunction.Apply(data, input);
+            }
         }
+
+        // every frame of every channel in one execution
+        fftwf_execute_dft_r2c(m_fftPlans[numBatchFrames]->Get(), m_fftInput, m_fftOutput);
+    }
+
+    size_t numSpectra = m_numChannels + 2;
+
+    if (numBatchFrames == 1)
+    {
+        CalculatePower(AnalyzeFrame(firstFrame, 0), m_spectra.data(), m_spectraMax.data());
+    }
+    else
+    {
+        size_t numValues = m_spectra.size();
+
+        CalculatePower(AnalyzeFrame(firstFrame, 0), m_spectra.data(), m_spectraMax.data());
+
+        for (size_t frame = 1; frame < numBatchFrames; ++frame)
+        {
+            CalculatePower(AnalyzeFrame(firstFrame + frame, frame), m_frameSpectra.data(), m_frameSpectraMax.data());
+
+            if (m_aggregation == SpectrumAggregation::Max)
+            {
+                for (size_t i = 0; i < numValues; ++i)
+                    m_spectra[i] = std::fmax(m_spectra[i], m_frameSpectra[i]);
+                for (size_t spectrum = 0; spectrum < numSpectra; ++spectrum)
+                    m_spectraMax[spectrum] = std::fmax(m_spectraMax[spectrum], m_frameSpectraMax[spectrum]);
+            }
+            else
+            {
+                for (size_t i = 0; i < numValues; ++i)
+                    m_spectra[i] += m_frameSpectra[i];
+            }
+        }
+
+        // the mean of the peaks is not the peak of the mean
+        if (m_aggregation == SpectrumAggregation::Mean)
+        {
+            for (size_t spectrum = 0; spectrum < numSpectra; ++spectrum)
+            {
+                float* values = &m_spectra[spectrum * m_spectrumSize];
+                float max = 0.f;
+
+                for (size_t i = 0; i < m_spectrumSize; ++i)
+                {
+                    values[i] /= numBatchFrames;
+                    max = std::fmax(max, values[i]);
+                }
+
+                m_spectraMax[spectrum] = max;
+            }
+        }
+    }
+
+    FinishSpectra();
+}
+
+fftwf_complex const* AudioTransform::AnalyzeFrame(size_t captureFrame, size_t batchFrame)
+{
+    if (m_analysisMode == AnalysisMode::MultiResolution)
+    {
+        for (size_t channel = 0; channel < m_numChannels; ++channel)
+            m_frameData[channel] = m_audioCapture->GetFrameData(captureFrame, channel);
+
+        m_multiResolution.Apply(m_frameData.data(), m_analysisOutput);
+        return m_analysisOutput;
+    }
+
+    if (m_analysisMode == AnalysisMode::SlidingDFT)
+    {
+        for (size_t channel = 0; channel < m_numChannels; ++channel)
+            m_frameData[channel] = m_audioCapture->GetFrameData(captureFrame, channel);
+
+        // every sample since the previous Capture() is the newest of the one frame
+        m_slidingDFT.Update(m_frameData.data(), m_audioCapture->GetFrameNumSamples(), m_audioCapture->GetNumNewSamples(), m_analysisOutput);
+        return m_analysisOutput;
+    }
+
+    size_t numFFTBins = m_fftSize / 2 + 1;
+    fftwf_complex const* output = m_fftOutput + batchFrame * m_numChannels * numFFTBins;
+
+    if (m_analysisMode != AnalysisMode::ConstantQ)
+        return output;
+
+    for (size_t channel = 0; channel < m_numChannels; ++channel)
+        m_constantQKernel.Apply(output + channel * numFFTBins, m_analysisOutput + channel * m_spectrumSize);
+
+    return m_analysisOutput;
+}
+
+void AudioTransform::CalculatePower(fftwf_complex const* output, float* spectra, float* spectraMax)
+{
+    for (size_t channel = 0; channel < m_numChannels; ++channel)
+        m_powerInputs[channel] = (float const*)&output[channel * m_spectrumSize];
+
+    // the transform is linear, so mid and side come from the channel spectra without transforms of their own
+    spectraMax[0] = m_powerKernel(m_powerInputs.data(), m_midWeights.data(), m_numChannels, m_spectrumSize, &spectra[0]);
+
+    if (m_numChannels > 1)
+    {
+        float const sideWeights[] = { 0.5f, -0.5f };
+        spectraMax[1] = m_powerKernel(m_powerInputs.data(), sideWeights, 2, m_spectrumSize, &spectra[m_spectrumSize]);
+    }
+    else
+    {
+        std::fill(&spectra[m_spectrumSize], &spectra[2 * m_spectrumSize], 0.f);
+        spectraMax[1] = 0.f;
+    }
+
+    float const channelWeight = 1.f;
+
+    for (size_t channel = 0; channel < m_numChannels; ++channel)
+        spectraMax[channel + 2] = m_powerKernel(&m_powerInputs[channel], &channelWeight, 1, m_spectrumSize, &spectra[(channel + 2) * m_spectrumSize]);
+}
+
+void AudioTransform::FinishSpectra()
+{
+    size_t numBands = m_perceptualFilterbank.GetNumBands();
+
+    // the bands sum power, so they have to come before the levels
+    for (size_t spectrum = 0; spectrum < m_numChannels + 2 && numBands > 0; ++spectrum)
+    {
+        m_perceptualSpectraMax[spectrum] = m_perceptualFilterbank.Apply(&m_spectra[spectrum * m_spectrumSize], &m_perceptualSpectra[spectrum * numBands]);
+        PostProcess(&m_perceptualSpectra[spectrum * numBands], numBands, m_perceptualSpectraMax[spectrum]);
+    }
+
+    for (size_t spectrum = 0; spectrum < m_numChannels + 2; ++spectrum)
+        PostProcess(&m_spectra[spectrum * m_spectrumSize], m_spectrumSize, m_spectraMax[spectrum]);
+}
+
+void AudioTransform::PostProcess(float* spectrum, size_t size, float maxPower)
+{
+    // normalize so the loudest bin has a magnitude of at most 1
+    float scale = maxPower > 1.f ? 1.f / maxPower : 1.f;
+
+    if (m_decibelMode)
+    {
+        // 20 log10(magnitude) is 10 log10(power), so no square roots; the normalization and the
+        // mapping of [cutoff, 0] dB to [0, 1] fold into one scale and offset of log2(power)
+        float cutoff = std::fabs(m_decibelCutoff);
+
+        m_decibelKernel(spectrum, size, 10.f * std::log10(2.f) / cutoff, 1.f + 10.f * std::log10(scale) / cutoff);
+    }
+    else
+    {
+        m_magnitudeKernel(spectrum, size, scale);
     }
 }
 
 float const* AudioTransform::GetSpectrum() const
 {
-    return m_spectrum.data();
+    return &m_spectra[0];
+}
+
+float const* AudioTransform::GetSideSpectrum() const
+{
+    return &m_spectra[m_spectrumSize];
+}
+
+float const* AudioTransform::GetChannelSpectrum(size_t channel) const
+{
+    return &m_spectra[(channel + 2) * m_spectrumSize];
+}
+
+float const* AudioTransform::GetPerceptualSpectrum() const
+{
+    return m_perceptualSpectra.data();
+}
+
+float const* AudioTransform::GetPerceptualSideSpectrum() const
+{
+    return m_perceptualSpectra.data() + GetPerceptualSpectrumSize();
+}
+
+float const* AudioTransform::GetPerceptualChannelSpectrum(size_t channel) const
+{
+    return m_perceptualSpectra.data() + (channel + 2) * GetPerceptualSpectrumSize();
+}
+
+size_t AudioTransform::GetPerceptualSpectrumSize() const
+{
+    return m_perceptualFilterbank.GetNumBands();
+}
+
+float AudioTransform::GetPerceptualFrequency(size_t band) const
+{
+    return m_perceptualFilterbank.GetFrequency(band);
+}
+
+PerceptualScale AudioTransform::GetPerceptualScale() const
+{
+    return m_perceptualScale;
+}
+
+size_t AudioTransform::GetNumPerceptualBands() const
+{
+    return m_numPerceptualBands;
+}
+
+void AudioTransform::SetPerceptualScale(PerceptualScale scale, size_t numBands)
+{
+    m_perceptualScale = scale;
+    m_numPerceptualBands = (std::max)(numBands, (size_t)1);
+
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
 }
 
 size_t AudioTransform::GetSpectrumSize() const
 {
-    return m_spectrum.size();
+    return m_spectrumSize;
+}
+
+size_t AudioTransform::GetNumChannels() const
+{
+    return m_numChannels;
+}
+
+bool AudioTransform::IsDecibelMode() const
+{
+    return m_decibelMode;
 }
 
 void AudioTransform::ToggleDecibelMode()
@@ -102,23 +427,362 @@ void AudioTransform::ToggleDecibelMode()
     m_decibelMode = !m_decibelMode;
 }
 
+WindowFunctionType AudioTransform::GetWindowFunction() const
+{
+    return m_windowFunction.GetType();
+}
+
+void AudioTransform::SetWindowFunction(WindowFunctionType type)
+{
+    m_windowFunction.Reset(type, m_audioCapture->GetWindowNumSamples());
+
+    if (m_analysisMode == AnalysisMode::MultiResolution)
+        m_multiResolution.SetWindowFunction(type);
+}
+
+float AudioTransform::GetSpectrumFrequency(size_t i) const
+{
+    if (m_analysisMode == AnalysisMode::ConstantQ)
+        return m_constantQKernel.GetFrequency(i);
+    if (m_analysisMode == AnalysisMode::MultiResolution)
+        return m_multiResolution.GetFrequency(i);
+    if (m_analysisMode == AnalysisMode::SlidingDFT)
+        return m_slidingDFT.GetFrequency(i);
+    if (m_analysisMode == AnalysisMode::Filterbank)
+        return m_filterbank.GetFrequency(i);
+
+    return (float)i * m_audioCapture->GetSampleRate() / m_fftSize;
+}
+
+bool AudioTransform::CopySettings(AudioTransform const* other)
+{
+    if (m_decibelMode != other->m_decibelMode)
+        ToggleDecibelMode();
+    m_aggregation = other->m_aggregation;
+
+    if (m_windowFunction.GetType() != other->m_windowFunction.GetType())
+        SetWindowFunction(other->m_windowFunction.GetType());
+
+    bool didLayoutChange = m_analysisMode != other->m_analysisMode ||
+        m_binsPerOctave != other->m_binsPerOctave ||
+        m_crossoverLow != other->m_crossoverLow ||
+        m_crossoverHigh != other->m_crossoverHigh ||
+        m_numBands != other->m_numBands ||
+        m_filterFrequencies != other->m_filterFrequencies ||
+        m_fftSizeRounding != other->m_fftSizeRounding ||
+        m_zeroPadding != other->m_zeroPadding;
+
+    if (!didLayoutChange && m_overlap == other->m_overlap &&
+        m_perceptualScale == other->m_perceptualScale && m_numPerceptualBands == other->m_numPerceptualBands)
+    {
+        return false;
+    }
+
+    m_analysisMode = other->m_analysisMode;
+    m_binsPerOctave = other->m_binsPerOctave;
+    m_crossoverLow = other->m_crossoverLow;
+    m_crossoverHigh = other->m_crossoverHigh;
+    m_numBands = other->m_numBands;
+    m_filterFrequencies = other->m_filterFrequencies;
+    m_fftSizeRounding = other->m_fftSizeRounding;
+    m_zeroPadding = other->m_zeroPadding;
+    m_overlap = other->m_overlap;
+    m_perceptualScale = other->m_perceptualScale;
+    m_numPerceptualBands = other->m_numPerceptualBands;
+
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
+
+    return didLayoutChange;
+}
+
+AnalysisMode AudioTransform::GetAnalysisMode() const
+{
+    return m_analysisMode;
+}
+
+void AudioTransform::SetAnalysisMode(AnalysisMode mode)
+{
+    m_analysisMode = mode;
+
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
+}
+
+size_t AudioTransform::GetBinsPerOctave() const
+{
+    return m_binsPerOctave;
+}
+
+void AudioTransform::SetBinsPerOctave(size_t binsPerOctave)
+{
+    m_binsPerOctave = (std::max)(binsPerOctave, (size_t)1);
+
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
+}
+
+float AudioTransform::GetCrossoverLow() const
+{
+    return m_crossoverLow;
+}
+
+float AudioTransform::GetCrossoverHigh() const
+{
+    return m_crossoverHigh;
+}
+
+void AudioTransform::SetCrossovers(float crossoverLow, float crossoverHigh)
+{
+    m_crossoverLow = crossoverLow;
+    m_crossoverHigh = crossoverHigh;
+
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
+}
+
+size_t AudioTransform::GetNumBands() const
+{
+    return m_numBands;
+}
+
+void AudioTransform::SetNumBands(size_t numBands)
+{
+    m_numBands = (std::max)(numBands, (size_t)1);
+
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
+}
+
+std::vector<float> const& AudioTransform::GetFilterFrequencies() const
+{
+    return m_filterFrequencies;
+}
+
+void AudioTransform::SetFilterFrequencies(std::vector<float> const& frequencies)
+{
+    if (frequencies == m_filterFrequencies)
+        return;
+
+    m_filterFrequencies = frequencies;
+
+    if (m_analysisMode != AnalysisMode::Filterbank)
+        return;
+
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
+}
+
+size_t AudioTransform::GetFFTSize() const
+{
+    return m_fftSize;
+}
+
+FFTSizeRounding AudioTransform::GetFFTSizeRounding() const
+{
+    return m_fftSizeRounding;
+}
+
+size_t AudioTransform::GetZeroPadding() const
+{
+    return m_zeroPadding;
+}
+
+void AudioTransform::SetFFTSize(FFTSizeRounding rounding, size_t zeroPadding)
+{
+    m_fftSizeRounding = rounding;
+    m_zeroPadding = (std::max)(zeroPadding, (size_t)1);
+
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
+}
+
+float AudioTransform::GetOverlap() const
+{
+    return m_overlap;
+}
+
+void AudioTransform::SetOverlap(float overlap)
+{
+    m_overlap = std::fmin(std::fmax(overlap, 0.f), 0.9375f);
+
+    // the batch sizes depend on the hop
+    DestroyFFT();
+    if (!InitializeFFT())
+        std::cerr << "Could not reinitialize FFT" << std::endl;
+}
+
+SpectrumAggregation AudioTransform::GetAggregation() const
+{
+    return m_aggregation;
+}
+
+void AudioTransform::SetAggregation(SpectrumAggregation aggregation)
+{
+    m_aggregation = aggregation;
+}
+
 bool AudioTransform::InitializeFFT()
 {
-    m_fftInput = fftwf_alloc_real(m_audioCapture->GetWindowNumSamples());
-    if (!m_fftInput)
-        goto fail;
+    int windowNumSamples = (int)m_audioCapture->GetWindowNumSamples();
+    size_t sampleRate = m_audioCapture->GetSampleRate();
 
-    // http://www.fftw.org/fftw3_doc/One_002dDimensional-DFTs-of-Real-Data.html
-    // https://www.ehu.eus/sgi/ARCHIVOS/fftw3.pdf#One-Dimensional%20DFTs%20of%20Real%20Data
-    m_fftOutput = fftwf_alloc_complex(m_audioCapture->GetWindowNumSamples() / 2 + 1);
-    if (!m_fftOutput)
-        goto fail;
+    size_t frameNumSamples;
+    size_t hopNumSamples;
+    size_t maxNumFrames;
 
-    m_fftPlan = fftwf_plan_dft_r2c_1d((int)m_audioCapture->GetWindowNumSamples(), m_fftInput, m_fftOutput, FFTW_ESTIMATE);
-    if (!m_fftPlan)
-        goto fail;
+    m_numChannels = m_audioCapture->GetNumChannels();
+
+    if (m_analysisMode == AnalysisMode::ConstantQ)
+    {
+        // unpadded frames as long as the longest constant-Q window, as far as the capture can keep them
+        m_fftSize = RoundFFTSize(ConstantQKernel::GetFrameNumSamples(sampleRate, m_binsPerOctave, s_constantQFrequencyLow), m_fftSizeRounding);
+        if (m_fftSize > m_audioCapture->GetMaxFrameNumSamples())
+            m_fftSize = RoundFFTSizeDown(m_audioCapture->GetMaxFrameNumSamples(), m_fftSizeRounding);
+
+        // scaled so levels match those of the FFT mode
+        m_constantQKernel.Reset(sampleRate, m_fftSize, m_binsPerOctave, s_constantQFrequencyLow, s_constantQFrequencyHigh, (float)windowNumSamples);
+
+        frameNumSamples = m_fftSize;
+        m_spectrumSize = m_constantQKernel.GetNumBins();
+    }
+    else if (m_analysisMode == AnalysisMode::MultiResolution)
+    {
+        if (!m_multiResolution.Reset(m_fftPlanCache, sampleRate, m_numChannels, m_windowFunction.GetType(),
+            m_crossoverLow, m_crossoverHigh, (float)windowNumSamples))
+        {
+            goto fail;
+        }
+
+        m_fftSize = 0;
+
+        frameNumSamples = m_multiResolution.GetFrameNumSamples();
+        if (frameNumSamples > m_audioCapture->GetMaxFrameNumSamples())
+        {
+            std::cerr << "Capture cannot hold a multi-resolution frame" << std::endl;
+            goto fail;
+        }
+
+        m_spectrumSize = m_multiResolution.GetNumBins();
+    }
+    else if (m_analysisMode == AnalysisMode::SlidingDFT)
+    {
+        m_slidingDFT.Reset(sampleRate, m_numChannels, m_numBands, s_bandFrequencyLow, s_bandFrequencyHigh, (float)windowNumSamples);
+
+        m_fftSize = 0;
+
+        // one frame with all the history the capture keeps, so the bands can slide over whatever arrived
+        // since the previous Transform() and drop the samples that leave their windows
+        frameNumSamples = m_audioCapture->GetMaxFrameNumSamples();
+        if (frameNumSamples <= m_slidingDFT.GetWindowNumSamples())
+        {
+            std::cerr << "Capture cannot hold the sliding DFT windows" << std::endl;
+            goto fail;
+        }
 
-    m_spectrum.resize(m_audioCapture->GetWindowNumSamples() / 2 + 1);
+        m_spectrumSize = m_slidingDFT.GetNumBins();
+    }
+    else if (m_analysisMode == AnalysisMode::Filterbank)
+    {
+        std::vector<float> frequencies = m_filterFrequencies;
+
+        if (frequencies.empty())
+        {
+            for (size_t band = 0; band < m_numBands; ++band)
+                frequencies.push_back(s_bandFrequencyLow * std::pow(s_bandFrequencyHigh / s_bandFrequencyLow, (float)band / (std::max)(m_numBands - 1, (size_t)1)));
+        }
+
+        m_filterbank.Reset(sampleRate, m_numChannels, frequencies, (float)windowNumSamples);
+
+        m_fftSize = 0;
+
+        // the history only bridges the gap between two Transform() calls, the filters keep their own
+        frameNumSamples = m_audioCapture->GetMaxFrameNumSamples();
+        m_spectrumSize = m_filterbank.GetNumBins();
+    }
+    else
+    {
+        m_fftSize = RoundFFTSize(windowNumSamples * m_zeroPadding, m_fftSizeRounding);
+
+        frameNumSamples = windowNumSamples;
+        m_spectrumSize = m_fftSize / 2 + 1;
+    }
+
+    m_windowFunction.Reset(m_windowFunction.GetType(), windowNumSamples);
+
+    // without overlap the capture keeps exposing just the latest frame; frames advance by the window either way,
+    // constant-Q frames by their own length, or a hop as short as the window would batch dozens of them.
+    // The sliding DFT bands and the filters take every sample anyway
+    hopNumSamples = 0;
+    if (m_overlap > 0.f && m_analysisMode != AnalysisMode::SlidingDFT && m_analysisMode != AnalysisMode::Filterbank)
+    {
+        size_t hopFrameNumSamples = m_analysisMode == AnalysisMode::ConstantQ ? frameNumSamples : (size_t)windowNumSamples;
+        hopNumSamples = (std::max)((size_t)1, (size_t)std::lround(hopFrameNumSamples * (1.f - m_overlap)));
+    }
+    m_audioCapture->SetFraming(frameNumSamples, hopNumSamples);
+
+    maxNumFrames = m_audioCapture->GetMaxNumFrames();
+
+    if (m_analysisMode != AnalysisMode::FFT)
+    {
+        m_analysisOutput = fftwf_alloc_complex(m_numChannels * m_spectrumSize);
+        if (!m_analysisOutput)
+            goto fail;
+    }
+
+    if (m_fftSize > 0)
+    {
+        m_fftInput = fftwf_alloc_real(maxNumFrames * m_numChannels * m_fftSize);
+        if (!m_fftInput)
+            goto fail;
+
+        // only the windows are ever written and r2c plans preserve their input, so the padding is cleared once
+        std::fill(m_fftInput, m_fftInput + maxNumFrames * m_numChannels * m_fftSize, 0.f);
+
+        // http://www.fftw.org/fftw3_doc/One_002dDimensional-DFTs-of-Real-Data.html
+        // https://www.ehu.eus/sgi/ARCHIVOS/fftw3.pdf#One-Dimensional%20DFTs%20of%20Real%20Data
+        m_fftOutput = fftwf_alloc_complex(maxNumFrames * m_numChannels * (m_fftSize / 2 + 1));
+        if (!m_fftOutput)
+            goto fail;
+
+        // every batch up front, so that Transform() never plans while the measuring thread holds the planner
+        m_fftPlans.assign(maxNumFrames + 1, nullptr);
+        for (size_t numFrames = 1; numFrames <= maxNumFrames; ++numFrames)
+        {
+            m_fftPlans[numFrames] = m_fftPlanCache->Acquire((int)m_fftSize, (int)(numFrames * m_numChannels), m_fftInput, m_fftOutput);
+            if (!m_fftPlans[numFrames])
+                goto fail;
+        }
+    }
+
+    m_spectra.assign((m_numChannels + 2) * m_spectrumSize, 0.f);
+    m_frameSpectra.assign(m_spectra.size(), 0.f);
+    m_spectraMax.assign(m_numChannels + 2, 0.f);
+    m_frameSpectraMax.assign(m_numChannels + 2, 0.f);
+
+    // the spectrum layout is settled, so are the frequencies the bands are made of
+    {
+        std::vector<float> frequencies(m_spectrumSize);
+        for (size_t i = 0; i < m_spectrumSize; ++i)
+            frequencies[i] = GetSpectrumFrequency(i);
+
+        m_perceptualFilterbank.Reset(m_perceptualScale, m_numPerceptualBands, s_perceptualFrequencyLow,
+            (std::min)(s_perceptualFrequencyHigh, sampleRate / 2.f), frequencies);
+    }
+    m_perceptualSpectra.assign((m_numChannels + 2) * m_perceptualFilterbank.GetNumBands(), 0.f);
+    m_perceptualSpectraMax.assign(m_numChannels + 2, 0.f);
+
+    m_frameData.assign(m_numChannels, nullptr);
+    m_powerInputs.assign(m_numChannels, nullptr);
+    m_midWeights.assign(m_numChannels, 1.f / m_numChannels);
+    m_areSpectraSilent = true;
 
     return true;
 
@@ -129,10 +793,17 @@ fail:
 
 void AudioTransform::DestroyFFT()
 {
-    if (m_fftPlan)
-        fftwf_destroy_plan(m_fftPlan);
+    m_multiResolution.Destroy();
+
+    if (m_analysisOutput)
+        fftwf_free(m_analysisOutput);
     if (m_fftOutput)
         fftwf_free(m_fftOutput);
     if (m_fftInput)
         fftwf_free(m_fftInput);
+
+    m_fftPlans.clear();
+    m_analysisOutput = nullptr;
+    m_fftOutput = nullptr;
+    m_fftInput = nullptr;
 }
@@ -1,6 +1,14 @@
 #pragma once
 
+#include "BiquadFilterbank.h"
+#include "ConstantQKernel.h"
+#include "FFTPlanCache.h"
 #include "IInitializable.h"
+#include "MultiResolutionAnalysis.h"
+#include "PerceptualFilterbank.h"
+#include "SlidingDFT.h"
+#include "SpectrumKernels.h"
+#include "WindowFunction.h"
 
 #include <fftw3.h>
 
@@ -8,10 +16,40 @@
 
 class AudioCapture;
 
+// What the spectra hold: the bins of one FFT of the window, constant-Q bins spaced evenly per octave
+// computed from one longer FFT, the bins of long, medium and short FFTs stitched at two crossovers,
+// a few bands updated with every sample by sliding DFTs, or the envelopes of band-pass filters.
+enum class AnalysisMode
+{
+    FFT,
+    ConstantQ,
+    MultiResolution,
+    SlidingDFT,
+    Filterbank,
+};
+
+// Which transform lengths the zero-padded window is rounded up to.
+enum class FFTSizeRounding
+{
+    // the window length itself, no padding beyond the zero-padding factor
+    None,
+    // 2^a 3^b 5^c, which FFTW handles with its fastest codelets
+    Smooth,
+    PowerOfTwo,
+};
+
+// How the spectra of the frames that completed since the last Transform() are combined.
+enum class SpectrumAggregation
+{
+    Latest,
+    Mean,
+    Max,
+};
+
 class AudioTransform : public IInitializable
 {
 public:
-    AudioTransform(AudioCapture* capture, float decibelCutoff = -40.f);
+    AudioTransform(AudioCapture* capture, FFTPlanCache* fftPlanCache, float decibelCutoff = -40.f);
 
     AudioTransform(AudioTransform const&) = delete;
     AudioTransform(AudioTransform&&) = delete;
@@ -23,11 +61,73 @@ public:
 
     void Transform();
 
+    // mid is the mean of all channels, side half the difference of the first two
     float const* GetSpectrum() const;
+    float const* GetSideSpectrum() const;
+    float const* GetChannelSpectrum(size_t channel) const;
     size_t GetSpectrumSize() const;
+    size_t GetNumChannels() const;
+    // center frequency of spectrum entry i in Hz, rising with i
+    float GetSpectrumFrequency(size_t i) const;
+
+    // the spectra reduced to bands on a perceptual scale, in the same order and with the same levels; empty
+    // without a scale, as by default, so that nothing is spent on bands no one draws
+    float const* GetPerceptualSpectrum() const;
+    float const* GetPerceptualSideSpectrum() const;
+    float const* GetPerceptualChannelSpectrum(size_t channel) const;
+    size_t GetPerceptualSpectrumSize() const;
+    float GetPerceptualFrequency(size_t band) const;
+
+    PerceptualScale GetPerceptualScale() const;
+    size_t GetNumPerceptualBands() const;
+    void SetPerceptualScale(PerceptualScale scale, size_t numBands);
+
+    // takes over every setting of another transform, with a single reinitialization; returns whether the
+    // spectrum layout changed
+    bool CopySettings(AudioTransform const* other);
+
+    AnalysisMode GetAnalysisMode() const;
+    void SetAnalysisMode(AnalysisMode mode);
+
+    // constant-Q resolution, the lowest frequency rises with it as longer frames would be needed
+    size_t GetBinsPerOctave() const;
+    void SetBinsPerOctave(size_t binsPerOctave);
+
+    // where the multi-resolution spectrum switches from the bass to the mid band and from that to the treble
+    float GetCrossoverLow() const;
+    float GetCrossoverHigh() const;
+    void SetCrossovers(float crossoverLow, float crossoverHigh);
 
+    // number of sliding DFT bands, spaced evenly per octave
+    size_t GetNumBands() const;
+    void SetNumBands(size_t numBands);
+
+    // center frequencies of the filterbank bands, rising; without any the filters are placed like the sliding DFT bands
+    std::vector<float> const& GetFilterFrequencies() const;
+    void SetFilterFrequencies(std::vector<float> const& frequencies);
+
+    // transform length after zero-padding the window, or of a constant-Q frame; 0 for the multi-resolution
+    // and sliding DFT bands, which have lengths of their own, and the filterbank
+    size_t GetFFTSize() const;
+
+    // the window is padded to at least zeroPadding times its length, then rounded up
+    FFTSizeRounding GetFFTSizeRounding() const;
+    size_t GetZeroPadding() const;
+    void SetFFTSize(FFTSizeRounding rounding, size_t zeroPadding);
+
+    bool IsDecibelMode() const;
     void ToggleDecibelMode();
 
+    WindowFunctionType GetWindowFunction() const;
+    void SetWindowFunction(WindowFunctionType type);
+
+    // fraction of a window consecutive frames share; 0, the default, analyzes only the latest window once per Transform()
+    float GetOverlap() const;
+    void SetOverlap(float overlap);
+
+    SpectrumAggregation GetAggregation() const;
+    void SetAggregation(SpectrumAggregation aggregation);
+
     bool InitializeFFT();
     void DestroyFFT();
 
@@ -35,12 +135,67 @@ private:
     bool Initialize() override;
     void Destroy() override;
 
+    // the complex spectra of all channels of one frame of the batch
+    fftwf_complex const* AnalyzeFrame(size_t captureFrame, size_t batchFrame);
+    // writes the power of every spectrum of one frame and the largest power of each
+    void CalculatePower(fftwf_complex const* output, float* spectra, float* spectraMax);
+    // reduces the power spectra to perceptual bands and turns both into the final levels
+    void FinishSpectra();
+    void PostProcess(float* spectrum, size_t size, float maxPower);
+
     AudioCapture* m_audioCapture;
+    FFTPlanCache* m_fftPlanCache;
     bool m_decibelMode;
     float m_decibelCutoff;
 
+    AnalysisMode m_analysisMode;
+    size_t m_binsPerOctave;
+    ConstantQKernel m_constantQKernel;
+    float m_crossoverLow;
+    float m_crossoverHigh;
+    MultiResolutionAnalysis m_multiResolution;
+    size_t m_numBands;
+    SlidingDFT m_slidingDFT;
+    std::vector<float> m_filterFrequencies;
+    BiquadFilterbank m_filterbank;
+
+    size_t m_numChannels;
+    size_t m_fftSize;
+    size_t m_spectrumSize;
+    FFTSizeRounding m_fftSizeRounding;
+    size_t m_zeroPadding;
+
+    WindowFunction m_windowFunction;
+    float m_overlap;
+    SpectrumAggregation m_aggregation;
+
+    // one planar window per frame and channel, zero-padded to m_fftSize and transformed by a single batched plan owned by the cache
     float* m_fftInput;
     fftwf_complex* m_fftOutput;
-    fftwf_plan m_fftPlan;
-    std::vector<float> m_spectrum;
+    // constant-Q, multi-resolution or sliding DFT spectra of one frame
+    fftwf_complex* m_analysisOutput;
+    // indexed by the number of frames in the batch, acquired on first use
+    std::vector<FFTPlanCache::Plan const*> m_fftPlans;
+
+    PowerKernel m_powerKernel;
+    DecibelKernel m_decibelKernel;
+    MagnitudeKernel m_magnitudeKernel;
+
+    std::vector<float const*> m_frameData;
+    std::vector<float const*> m_powerInputs;
+    std::vector<float> m_midWeights;
+
+    // mid, side, then one spectrum per channel; power until PostProcess() turns it into levels
+    std::vector<float> m_spectra;
+    std::vector<float> m_frameSpectra;
+    std::vector<float> m_spectraMax;
+    std::vector<float> m_frameSpectraMax;
+    PerceptualScale m_perceptualScale;
+    size_t m_numPerceptualBands;
+    PerceptualFilterbank m_perceptualFilterbank;
+    std::vector<float> m_perceptualSpectra;
+    std::vector<float> m_perceptualSpectraMax;
+
+    // the spectra hold all zeros and a silent window cannot change that
+    bool m_areSpectraSilent;
 };
@@ -86,7 +86,7 @@ int main(int argc, char** argv)
     }
     else
     {
-        window.reset(new Window(false));
+        window.reset(new Window(false, argc > 1 ? argv[1] : std::string()));
     }
 
     if (!window->IsInitialized())
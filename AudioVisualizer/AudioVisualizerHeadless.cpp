@@ -0,0 +1,135 @@
+#include "AudioCapture.h"
+#include "AudioTransform.h"
+#include "FFTPlanCache.h"
+#include "Plot.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+// the plot is laid out as if it filled a full HD display
+#define HEADLESS_PLOT_WIDTH 1920
+#define HEADLESS_PLOT_HEIGHT 1080
+
+// Runs capture, analysis and the plot's update without a window, for bench hosts and other machines without a
+// display:
+//
+//   AudioVisualizerHeadless [source] [seconds]
+//
+// The source takes the same forms as the visualizer's first argument and defaults to the test signal.
+// Once a second it prints how long a frame's Capture(), Transform() and Plot::Update() took together and apart,
+// and where the loudest spectrum entry sits. Only drawing is left out.
+int main(int argc, char** argv)
+{
+    std::string source(argc > 1 ? argv[1] : "signal");
+    double duration = argc > 2 ? std::strtod(argv[2], nullptr) : 10.;
+
+#ifdef _WIN32
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    if (FAILED(hr))
+        return EXIT_FAILURE;
+#endif
+
+    int result = EXIT_FAILURE;
+
+    {
+        // declared so that the plot goes before the transform, and the transform before the capture and the plan
+        // cache it refers to
+        std::unique_ptr<FFTPlanCache> fftPlanCache(new FFTPlanCache(std::string(), FFTW_MEASURE, (int)std::thread::hardware_concurrency()));
+        std::unique_ptr<AudioCapture> capture(AudioCapture::Create(source));
+        std::unique_ptr<AudioTransform> transform;
+        std::unique_ptr<Plot> plot;
+
+        if (fftPlanCache->IsInitialized() && capture && capture->IsInitialized())
+            transform.reset(new AudioTransform(capture.get(), fftPlanCache.get()));
+
+        if (transform && transform->IsInitialized() && capture->Start())
+        {
+            plot.reset(new Plot(transform.get(), HEADLESS_PLOT_WIDTH, HEADLESS_PLOT_HEIGHT));
+
+            // paced like the render loop, which analyzes once per displayed frame
+            float deltaTime = 1000.f / 60.f;
+
+            auto start = std::chrono::steady_clock::now();
+            auto reportTime = start;
+
+            size_t numFrames = 0;
+            double frameTime = 0.;
+            double frameTimeMax = 0.;
+            double transformTime = 0.;
+            double updateTime = 0.;
+
+            while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < duration)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds((int)deltaTime));
+
+                auto frameStart = std::chrono::steady_clock::now();
+
+                if (!capture->Capture())
+                    continue;
+
+                auto transformStart = std::chrono::steady_clock::now();
+                transform->Transform();
+
+                auto updateStart = std::chrono::steady_clock::now();
+                plot->Update(deltaTime, deltaTime);
+
+                auto frameEnd = std::chrono::steady_clock::now();
+                double time = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+
+                ++numFrames;
+                frameTime += time;
+                frameTimeMax = (std::max)(frameTimeMax, time);
+                transformTime += std::chrono::duration<double, std::milli>(updateStart - transformStart).count();
+                updateTime += std::chrono::duration<double, std::milli>(frameEnd - updateStart).count();
+
+                if (frameEnd - reportTime < std::chrono::seconds(1))
+                    continue;
+
+                reportTime = frameEnd;
+
+                float const* spectrum = transform->GetSpectrum();
+                size_t peak = std::max_element(spectrum, spectrum + transform->GetSpectrumSize()) - spectrum;
+
+                std::cout << numFrames << " frames, "
+                    << frameTime / numFrames << " ms mean, "
+                    << frameTimeMax << " ms max, "
+                    << transformTime / numFrames << " ms mean in Transform(), "
+                    << updateTime / numFrames << " ms mean in Plot::Update(), "
+                    << "peak at " << transform->GetSpectrumFrequency(peak) << " Hz, "
+                    << capture->GetNumGlitches() << " glitches" << std::endl;
+
+                numFrames = 0;
+                frameTime = 0.;
+                frameTimeMax = 0.;
+                transformTime = 0.;
+                updateTime = 0.;
+            }
+
+            capture->Stop();
+            result = EXIT_SUCCESS;
+        }
+        else
+        {
+            std::cerr << "Could not start capture from " << source << std::endl;
+        }
+    }
+
+#ifdef _WIN32
+    CoUninitialize();
+#endif
+
+    return result;
+}
@@ -0,0 +1,139 @@
+#include "BarKernels.h"
+
+#include <SDL.h>
+
+#include <stddef.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BAR_KERNELS_X86
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define BAR_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static void BarRange(float* levels, float* hatLevels, float* hatVelocities, float const* targets, size_t firstBar, size_t numBars,
+    float targetScale, float smoothing, float gravityStep, float dt)
+{
+    for (size_t i = firstBar; i < numBars; ++i)
+    {
+        float level = levels[i] + smoothing * (targets[i] * targetScale - levels[i]);
+
+        float velocity = hatVelocities[i] - gravityStep;
+        float hatLevelNext = hatLevels[i] + velocity * dt;
+
+        bool isAbove = hatLevels[i] > level;
+        bool isFalling = isAbove && hatLevelNext > level;
+
+        levels[i] = level;
+        hatLevels[i] = isFalling ? hatLevelNext : level;
+        hatVelocities[i] = isFalling ? velocity : isAbove ? 0.f : hatVelocities[i];
+    }
+}
+
+static void BarScalar(float* levels, float* hatLevels, float* hatVelocities, float const* targets, size_t numBars,
+    float targetScale, float smoothing, float gravityStep, float dt)
+{
+    BarRange(levels, hatLevels, hatVelocities, targets, 0, numBars, targetScale, smoothing, gravityStep, dt);
+}
+
+#ifdef BAR_KERNELS_X86
+
+// a * b + c; SDL cannot tell whether FMA is there, so no fused multiply-add
+TARGET_AVX2 static inline __m256 MulAdd(__m256 a, __m256 b, __m256 c)
+{
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+}
+
+TARGET_AVX2 static void BarAVX2(float* levels, float* hatLevels, float* hatVelocities, float const* targets, size_t numBars,
+    float targetScale, float smoothing, float gravityStep, float dt)
+{
+    __m256 targetScale8 = _mm256_set1_ps(targetScale);
+    __m256 smoothing8 = _mm256_set1_ps(smoothing);
+    __m256 gravityStep8 = _mm256_set1_ps(gravityStep);
+    __m256 dt8 = _mm256_set1_ps(dt);
+    size_t i = 0;
+
+    for (; i + 8 <= numBars; i += 8)
+    {
+        __m256 level = _mm256_loadu_ps(levels + i);
+        __m256 hatLevel = _mm256_loadu_ps(hatLevels + i);
+        __m256 hatVelocity = _mm256_loadu_ps(hatVelocities + i);
+
+        level = MulAdd(smoothing8, _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(targets + i), targetScale8), level), level);
+
+        __m256 velocity = _mm256_sub_ps(hatVelocity, gravityStep8);
+        __m256 hatLevelNext = MulAdd(velocity, dt8, hatLevel);
+
+        __m256 isAbove = _mm256_cmp_ps(hatLevel, level, _CMP_GT_OQ);
+        __m256 isFalling = _mm256_and_ps(isAbove, _mm256_cmp_ps(hatLevelNext, level, _CMP_GT_OQ));
+
+        // landed hats stop, lifted ones keep whatever velocity they had
+        hatVelocity = _mm256_andnot_ps(isAbove, hatVelocity);
+
+        _mm256_storeu_ps(levels + i, level);
+        _mm256_storeu_ps(hatLevels + i, _mm256_blendv_ps(level, hatLevelNext, isFalling));
+        _mm256_storeu_ps(hatVelocities + i, _mm256_blendv_ps(hatVelocity, velocity, isFalling));
+    }
+
+    BarRange(levels, hatLevels, hatVelocities, targets, i, numBars, targetScale, smoothing, gravityStep, dt);
+}
+
+#endif
+
+#ifdef BAR_KERNELS_NEON
+
+static void BarNEON(float* levels, float* hatLevels, float* hatVelocities, float const* targets, size_t numBars,
+    float targetScale, float smoothing, float gravityStep, float dt)
+{
+    float32x4_t targetScale4 = vdupq_n_f32(targetScale);
+    float32x4_t smoothing4 = vdupq_n_f32(smoothing);
+    float32x4_t gravityStep4 = vdupq_n_f32(gravityStep);
+    float32x4_t dt4 = vdupq_n_f32(dt);
+    size_t i = 0;
+
+    for (; i + 4 <= numBars; i += 4)
+    {
+        float32x4_t level = vld1q_f32(levels + i);
+        float32x4_t hatLevel = vld1q_f32(hatLevels + i);
+        float32x4_t hatVelocity = vld1q_f32(hatVelocities + i);
+
+        level = vmlaq_f32(level, smoothing4, vsubq_f32(vmulq_f32(vld1q_f32(targets + i), targetScale4), level));
+
+        float32x4_t velocity = vsubq_f32(hatVelocity, gravityStep4);
+        float32x4_t hatLevelNext = vmlaq_f32(hatLevel, velocity, dt4);
+
+        uint32x4_t isAbove = vcgtq_f32(hatLevel, level);
+        uint32x4_t isFalling = vandq_u32(isAbove, vcgtq_f32(hatLevelNext, level));
+
+        // landed hats stop, lifted ones keep whatever velocity they had
+        hatVelocity = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(hatVelocity), isAbove));
+
+        vst1q_f32(levels + i, level);
+        vst1q_f32(hatLevels + i, vbslq_f32(isFalling, hatLevelNext, level));
+        vst1q_f32(hatVelocities + i, vbslq_f32(isFalling, velocity, hatVelocity));
+    }
+
+    BarRange(levels, hatLevels, hatVelocities, targets, i, numBars, targetScale, smoothing, gravityStep, dt);
+}
+
+#endif
+
+BarKernel SelectBarKernel()
+{
+#if defined(BAR_KERNELS_X86)
+    if (SDL_HasAVX2() == SDL_TRUE)
+        return BarAVX2;
+#elif defined(BAR_KERNELS_NEON)
+    if (SDL_HasNEON() == SDL_TRUE)
+        return BarNEON;
+#endif
+
+    return BarScalar;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stddef.h>
+
+// Moves numBars levels a fraction smoothing of the way towards targets * targetScale, then lets every hat above
+// its bar fall by one step: the velocity drops by gravityStep and the hat moves by velocity * dt, landing on the
+// bar (and stopping) once it would sink below it. Hats at or below their bar are lifted onto it.
+typedef void (*BarKernel)(float* levels, float* hatLevels, float* hatVelocities, float const* targets, size_t numBars,
+    float targetScale, float smoothing, float gravityStep, float dt);
+
+// Pick the fastest kernel on the running CPU (AVX2, NEON or scalar).
+BarKernel SelectBarKernel();
@@ -0,0 +1,337 @@
+#include "BiquadFilterbank.h"
+
+#include <SDL.h>
+
+#include <stddef.h>
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BIQUAD_KERNELS_X86
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define BIQUAD_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static double const s_pi = 3.14159265358979323846;
+
+static size_t const s_groupSize = BiquadLanes::s_biquadGroupSize;
+
+// a band-pass filter does not pass it, but it keeps decaying states from turning denormal
+static float const s_antiDenormal = 1e-18f;
+
+// the envelopes rise within a millisecond and fall over at least four periods of their band
+static double const s_attackTime = 0.001;
+static double const s_releaseTime = 0.05;
+static double const s_releasePeriods = 4.;
+
+static inline void Follow(float& envelope, float level, float attack, float release)
+{
+    float difference = level - envelope;
+    envelope += (difference > 0.f ? attack : release) * difference;
+}
+
+static void BiquadScalar(BiquadLanes& lanes, float const* const* inputs, size_t numSamples)
+{
+    size_t numLanes = lanes.numLanes;
+    size_t numChannels = lanes.numChannels;
+    float midWeight = 1.f / numChannels;
+
+    for (size_t group = 0; group < numLanes; group += s_groupSize)
+    {
+        for (size_t n = 0; n < numSamples; ++n)
+        {
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                float x = inputs[channel][n] + s_antiDenormal;
+
+                for (size_t lane = 0; lane < s_groupSize; ++lane)
+                {
+                    size_t i = group + lane;
+                    size_t state = channel * numLanes + i;
+
+                    float y = lanes.b0[i] * x + lanes.z1[state];
+                    lanes.z1[state] = lanes.z2[state] - lanes.a1[i] * y;
+                    lanes.z2[state] = -lanes.b0[i] * x - lanes.a2[i] * y;
+
+                    lanes.outputs[channel * s_groupSize + lane] = y;
+                }
+            }
+
+            for (size_t lane = 0; lane < s_groupSize; ++lane)
+            {
+                size_t i = group + lane;
+
+                float mid = 0.f;
+                for (size_t channel = 0; channel < numChannels; ++channel)
+                    mid += lanes.outputs[channel * s_groupSize + lane];
+
+                Follow(lanes.envelopes[i], std::fabs(mid * midWeight), lanes.attack[i], lanes.release[i]);
+
+                if (numChannels > 1)
+                {
+                    float side = 0.5f * (lanes.outputs[lane] - lanes.outputs[s_groupSize + lane]);
+                    Follow(lanes.envelopes[numLanes + i], std::fabs(side), lanes.attack[i], lanes.release[i]);
+                }
+
+                for (size_t channel = 0; channel < numChannels; ++channel)
+                {
+                    Follow(lanes.envelopes[(channel + 2) * numLanes + i], std::fabs(lanes.outputs[channel * s_groupSize + lane]),
+                        lanes.attack[i], lanes.release[i]);
+                }
+            }
+        }
+    }
+}
+
+#ifdef BIQUAD_KERNELS_X86
+
+// a * b + c; SDL cannot tell whether FMA is there, so no fused multiply-add
+TARGET_AVX2 static inline __m256 MulAdd(__m256 a, __m256 b, __m256 c)
+{
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+}
+
+TARGET_AVX2 static inline void FollowAVX2(float* envelope, __m256 level, __m256 attack, __m256 release)
+{
+    __m256 current = _mm256_loadu_ps(envelope);
+    __m256 difference = _mm256_sub_ps(level, current);
+    __m256 step = _mm256_blendv_ps(release, attack, _mm256_cmp_ps(difference, _mm256_setzero_ps(), _CMP_GT_OQ));
+
+    _mm256_storeu_ps(envelope, MulAdd(step, difference, current));
+}
+
+// one group of eight filters per register
+TARGET_AVX2 static void BiquadAVX2(BiquadLanes& lanes, float const* const* inputs, size_t numSamples)
+{
+    size_t numLanes = lanes.numLanes;
+    size_t numChannels = lanes.numChannels;
+
+    __m256 midWeight = _mm256_set1_ps(1.f / numChannels);
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 signMask = _mm256_set1_ps(-0.f);
+
+    for (size_t group = 0; group < numLanes; group += s_groupSize)
+    {
+        __m256 b0 = _mm256_loadu_ps(&lanes.b0[group]);
+        __m256 a1 = _mm256_loadu_ps(&lanes.a1[group]);
+        __m256 a2 = _mm256_loadu_ps(&lanes.a2[group]);
+        __m256 attack = _mm256_loadu_ps(&lanes.attack[group]);
+        __m256 release = _mm256_loadu_ps(&lanes.release[group]);
+
+        for (size_t n = 0; n < numSamples; ++n)
+        {
+            __m256 mid = _mm256_setzero_ps();
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                float* z1 = &lanes.z1[channel * numLanes + group];
+                float* z2 = &lanes.z2[channel * numLanes + group];
+
+                __m256 x = _mm256_set1_ps(inputs[channel][n] + s_antiDenormal);
+                __m256 b0x = _mm256_mul_ps(b0, x);
+
+                __m256 y = _mm256_add_ps(b0x, _mm256_loadu_ps(z1));
+                _mm256_storeu_ps(z1, _mm256_sub_ps(_mm256_loadu_ps(z2), _mm256_mul_ps(a1, y)));
+                _mm256_storeu_ps(z2, _mm256_sub_ps(_mm256_setzero_ps(), MulAdd(a2, y, b0x)));
+
+                _mm256_storeu_ps(&lanes.outputs[channel * s_groupSize], y);
+                mid = _mm256_add_ps(mid, y);
+
+                FollowAVX2(&lanes.envelopes[(channel + 2) * numLanes + group], _mm256_andnot_ps(signMask, y), attack, release);
+            }
+
+            FollowAVX2(&lanes.envelopes[group], _mm256_andnot_ps(signMask, _mm256_mul_ps(mid, midWeight)), attack, release);
+
+            if (numChannels > 1)
+            {
+                __m256 side = _mm256_mul_ps(half, _mm256_sub_ps(_mm256_loadu_ps(&lanes.outputs[0]), _mm256_loadu_ps(&lanes.outputs[s_groupSize])));
+                FollowAVX2(&lanes.envelopes[numLanes + group], _mm256_andnot_ps(signMask, side), attack, release);
+            }
+        }
+    }
+}
+
+#endif
+
+#ifdef BIQUAD_KERNELS_NEON
+
+static inline void FollowNEON(float* envelope, float32x4_t level, float32x4_t attack, float32x4_t release)
+{
+    float32x4_t current = vld1q_f32(envelope);
+    float32x4_t difference = vsubq_f32(level, current);
+    float32x4_t step = vbslq_f32(vcgtq_f32(difference, vdupq_n_f32(0.f)), attack, release);
+
+    vst1q_f32(envelope, vmlaq_f32(current, step, difference));
+}
+
+// a group of eight filters is two registers, handled one after the other
+static void BiquadNEON(BiquadLanes& lanes, float const* const* inputs, size_t numSamples)
+{
+    size_t numLanes = lanes.numLanes;
+    size_t numChannels = lanes.numChannels;
+
+    float32x4_t midWeight = vdupq_n_f32(1.f / numChannels);
+    float32x4_t half = vdupq_n_f32(0.5f);
+
+    for (size_t group = 0; group < numLanes; group += 4)
+    {
+        float32x4_t b0 = vld1q_f32(&lanes.b0[group]);
+        float32x4_t a1 = vld1q_f32(&lanes.a1[group]);
+        float32x4_t a2 = vld1q_f32(&lanes.a2[group]);
+        float32x4_t attack = vld1q_f32(&lanes.attack[group]);
+        float32x4_t release = vld1q_f32(&lanes.release[group]);
+
+        for (size_t n = 0; n < numSamples; ++n)
+        {
+            float32x4_t mid = vdupq_n_f32(0.f);
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                float* z1 = &lanes.z1[channel * numLanes + group];
+                float* z2 = &lanes.z2[channel * numLanes + group];
+
+                float32x4_t x = vdupq_n_f32(inputs[channel][n] + s_antiDenormal);
+                float32x4_t b0x = vmulq_f32(b0, x);
+
+                float32x4_t y = vaddq_f32(b0x, vld1q_f32(z1));
+                vst1q_f32(z1, vmlsq_f32(vld1q_f32(z2), a1, y));
+                vst1q_f32(z2, vnegq_f32(vmlaq_f32(b0x, a2, y)));
+
+                vst1q_f32(&lanes.outputs[channel * s_groupSize], y);
+                mid = vaddq_f32(mid, y);
+
+                FollowNEON(&lanes.envelopes[(channel + 2) * numLanes + group], vabsq_f32(y), attack, release);
+            }
+
+            FollowNEON(&lanes.envelopes[group], vabsq_f32(vmulq_f32(mid, midWeight)), attack, release);
+
+            if (numChannels > 1)
+            {
+                float32x4_t side = vmulq_f32(half, vsubq_f32(vld1q_f32(&lanes.outputs[0]), vld1q_f32(&lanes.outputs[s_groupSize])));
+                FollowNEON(&lanes.envelopes[numLanes + group], vabsq_f32(side), attack, release);
+            }
+        }
+    }
+}
+
+#endif
+
+static BiquadKernel SelectBiquadKernel()
+{
+#if defined(BIQUAD_KERNELS_X86)
+    if (SDL_HasAVX2() == SDL_TRUE)
+        return BiquadAVX2;
+#elif defined(BIQUAD_KERNELS_NEON)
+    if (SDL_HasNEON() == SDL_TRUE)
+        return BiquadNEON;
+#endif
+
+    return BiquadScalar;
+}
+
+BiquadFilterbank::BiquadFilterbank()
+    : m_kernel(SelectBiquadKernel())
+    , m_scale()
+    , m_lanes()
+{
+}
+
+void BiquadFilterbank::Reset(size_t sampleRate, size_t numChannels, std::vector<float> const& frequencies, float scale)
+{
+    size_t numBins = frequencies.size();
+
+    m_frequencies = frequencies;
+    // a band-pass biquad passes its center frequency at unit gain and the envelopes follow the amplitude
+    m_scale = scale / 4.f;
+
+    m_lanes.numLanes = (numBins + s_groupSize - 1) / s_groupSize * s_groupSize;
+    m_lanes.numChannels = numChannels;
+
+    // the padding lanes have b0 = 0 and never see any input
+    m_lanes.b0.assign(m_lanes.numLanes, 0.f);
+    m_lanes.a1.assign(m_lanes.numLanes, 0.f);
+    m_lanes.a2.assign(m_lanes.numLanes, 0.f);
+    m_lanes.attack.assign(m_lanes.numLanes, 1.f);
+    m_lanes.release.assign(m_lanes.numLanes, 1.f);
+
+    double attack = 1. - std::exp(-1. / (s_attackTime * sampleRate));
+
+    for (size_t bin = 0; bin < numBins; ++bin)
+    {
+        // the band reaches halfway to its neighbours, the outer ones as far out as they reach in
+        double center = frequencies[bin];
+        double below = bin > 0 ? frequencies[bin - 1] : numBins > 1 ? center * center / frequencies[1] : center / 2.;
+        double above = bin + 1 < numBins ? frequencies[bin + 1] : numBins > 1 ? center * center / frequencies[bin - 1] : center * 2.;
+
+        double bandwidth = std::sqrt(center * above) - std::sqrt(center * below);
+        double q = bandwidth > 0. ? (std::min)((std::max)(center / bandwidth, 0.5), 50.) : 50.;
+
+        // RBJ band-pass with a peak gain of 0 dB, normalized by a0
+        double omega = 2. * s_pi * (std::min)(center, 0.45 * sampleRate) / sampleRate;
+        double alpha = std::sin(omega) / (2. * q);
+
+        m_lanes.b0[bin] = (float)(alpha / (1. + alpha));
+        m_lanes.a1[bin] = (float)(-2. * std::cos(omega) / (1. + alpha));
+        m_lanes.a2[bin] = (float)((1. - alpha) / (1. + alpha));
+
+        double releaseTime = (std::max)(s_releaseTime, s_releasePeriods / (std::max)(center, 1.));
+
+        m_lanes.attack[bin] = (float)attack;
+        m_lanes.release[bin] = (float)(1. - std::exp(-1. / (releaseTime * sampleRate)));
+    }
+
+    m_lanes.outputs.assign(numChannels * s_groupSize, 0.f);
+
+    Restart();
+}
+
+void BiquadFilterbank::Restart()
+{
+    m_lanes.z1.assign(m_lanes.numChannels * m_lanes.numLanes, 0.f);
+    m_lanes.z2.assign(m_lanes.numChannels * m_lanes.numLanes, 0.f);
+    m_lanes.envelopes.assign((m_lanes.numChannels + 2) * m_lanes.numLanes, 0.f);
+}
+
+size_t BiquadFilterbank::GetNumBins() const
+{
+    return m_frequencies.size();
+}
+
+float BiquadFilterbank::GetFrequency(size_t bin) const
+{
+    return m_frequencies[bin];
+}
+
+void BiquadFilterbank::Update(float const* const* inputs, size_t numSamples, float* spectra, float* spectraMax)
+{
+    size_t numBins = m_frequencies.size();
+
+    m_kernel(m_lanes, inputs, numSamples);
+
+    for (size_t spectrum = 0; spectrum < m_lanes.numChannels + 2; ++spectrum)
+    {
+        float const* envelopes = &m_lanes.envelopes[spectrum * m_lanes.numLanes];
+        float max = 0.f;
+
+        for (size_t bin = 0; bin < numBins; ++bin)
+        {
+            float magnitude = envelopes[bin] * m_scale;
+
+            spectra[spectrum * numBins + bin] = magnitude * magnitude;
+            max = std::fmax(max, spectra[spectrum * numBins + bin]);
+        }
+
+        spectraMax[spectrum] = max;
+    }
+}
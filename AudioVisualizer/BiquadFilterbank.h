@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+// Coefficients and state of the filters, one lane per filter in groups of s_biquadGroupSize, the last group
+// padded with filters that stay silent.
+struct BiquadLanes
+{
+    static size_t const s_biquadGroupSize = 8;
+
+    size_t numLanes;
+    size_t numChannels;
+
+    // band-pass biquads, b1 being 0 and b2 being -b0
+    std::vector<float> b0;
+    std::vector<float> a1;
+    std::vector<float> a2;
+    // envelope follower steps towards a rising and a falling level
+    std::vector<float> attack;
+    std::vector<float> release;
+
+    // per channel, transposed direct form II
+    std::vector<float> z1;
+    std::vector<float> z2;
+    // amplitude envelopes of mid, side and every channel
+    std::vector<float> envelopes;
+    // filter outputs of every channel for the sample at hand
+    std::vector<float> outputs;
+};
+
+// Runs numSamples of every channel through all the filters and follows the envelopes of their outputs.
+typedef void (*BiquadKernel)(BiquadLanes& lanes, float const* const* inputs, size_t numSamples);
+
+// Band-pass biquads around given center frequencies with envelope followers, for levels that lag the audio by
+// a few samples instead of a window. Neighbouring bands meet halfway between their centers on a logarithmic
+// scale, and the filters run side by side in SIMD lanes (AVX2, NEON or scalar), so the cost grows linearly with
+// the number of bands.
+class BiquadFilterbank
+{
+public:
+    BiquadFilterbank();
+
+    BiquadFilterbank(BiquadFilterbank const&) = delete;
+    BiquadFilterbank(BiquadFilterbank&&) = delete;
+
+    BiquadFilterbank& operator=(BiquadFilterbank const&) = delete;
+    BiquadFilterbank& operator=(BiquadFilterbank&&) = delete;
+
+    // frequencies have to rise; a sinusoid of amplitude a at a center frequency comes out with a magnitude of
+    // a * scale / 4, the same as a Hann-windowed FFT of scale samples
+    void Reset(size_t sampleRate, size_t numChannels, std::vector<float> const& frequencies, float scale);
+    // silences the filters and envelopes
+    void Restart();
+
+    size_t GetNumBins() const;
+    float GetFrequency(size_t bin) const;
+
+    // filters numSamples of each channel, then writes the power of the envelopes of mid, side and every channel,
+    // numChannels + 2 spectra of GetNumBins() entries, and the largest power of each
+    void Update(float const* const* inputs, size_t numSamples, float* spectra, float* spectraMax);
+
+private:
+    BiquadKernel m_kernel;
+
+    std::vector<float> m_frequencies;
+    float m_scale;
+    BiquadLanes m_lanes;
+};
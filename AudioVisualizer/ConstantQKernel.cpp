@@ -0,0 +1,146 @@
+#include "ConstantQKernel.h"
+
+#include <fftw3.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+
+#include <algorithm>
+#include <complex>
+#include <vector>
+
+static double const s_pi = 3.14159265358979323846;
+
+// entries below this fraction of a row's peak are dropped, about -60 dB
+static double const s_sparsity = 1e-3;
+
+static double GetQ(size_t binsPerOctave)
+{
+    return 1. / (std::pow(2., 1. / binsPerOctave) - 1.);
+}
+
+// sum of exp(i phi m) for m in [0, length)
+static std::complex<double> Dirichlet(double phi, size_t length)
+{
+    double denominator = std::sin(phi / 2.);
+
+    std::complex<double> rotation = std::polar(1., phi * (length - 1) / 2.);
+
+    if (std::fabs(denominator) < 1e-12)
+        return rotation * (double)length;
+
+    return rotation * (std::sin(phi * length / 2.) / denominator);
+}
+
+ConstantQKernel::ConstantQKernel()
+    : m_binsPerOctave()
+    , m_frequencyLow()
+    , m_numBins()
+{
+}
+
+size_t ConstantQKernel::GetFrameNumSamples(size_t sampleRate, size_t binsPerOctave, float frequencyLow)
+{
+    return (size_t)std::ceil(GetQ(binsPerOctave) * sampleRate / frequencyLow);
+}
+
+void ConstantQKernel::Reset(size_t sampleRate, size_t fftSize, size_t binsPerOctave, float frequencyLow, float frequencyHigh, float scale)
+{
+    double q = GetQ(binsPerOctave);
+
+    m_binsPerOctave = binsPerOctave;
+    m_frequencyLow = (std::max)(frequencyLow, (float)(q * sampleRate / fftSize));
+
+    // the r2c spectrum stops at the Nyquist frequency, so the main lobes have to as well
+    frequencyHigh = (std::min)(frequencyHigh, (float)(sampleRate / 2. / (1. + 2. / q)));
+
+    m_numBins = 0;
+    while (GetFrequency(m_numBins) <= frequencyHigh)
+        ++m_numBins;
+
+    m_rowOffsets.assign(1, 0);
+    m_columns.clear();
+    m_values.clear();
+
+    size_t numColumns = fftSize / 2 + 1;
+    std::vector<std::complex<double>> row;
+
+    for (size_t bin = 0; bin < m_numBins; ++bin)
+    {
+        double frequency = GetFrequency(bin);
+        size_t length = (std::min)((size_t)std::ceil(q * sampleRate / frequency), fftSize);
+        size_t start = fftSize - length;
+
+        // the DFT of the windowed exponential in closed form, the periodic Hann window being three exponentials;
+        // only the main lobe and a few side lobes around the center frequency are worth looking at
+        double center = frequency * fftSize / sampleRate;
+        double reach = 8. * fftSize / length + 4.;
+
+        size_t first = (size_t)(std::max)(0., std::floor(center - reach));
+        size_t last = (size_t)(std::min)((double)numColumns - 1., std::ceil(center + reach));
+
+        row.assign(last - first + 1, 0.);
+        double peak = 0.;
+
+        for (size_t column = first; column <= last; ++column)
+        {
+            double psi = 2. * s_pi * (frequency / sampleRate - (double)column / fftSize);
+
+            std::complex<double> sum = 0.5 * Dirichlet(psi, length)
+                - 0.25 * Dirichlet(psi + 2. * s_pi / length, length)
+                - 0.25 * Dirichlet(psi - 2. * s_pi / length, length);
+
+            std::complex<double> value = std::polar(1., psi * start) * sum * ((double)scale / length);
+
+            row[column - first] = value;
+            peak = (std::max)(peak, std::abs(value));
+        }
+
+        // Parseval: the inner product of the frame with the window is that of their spectra over fftSize
+        for (size_t column = first; column <= last; ++column)
+        {
+            std::complex<double> value = row[column - first];
+
+            if (std::abs(value) >= s_sparsity * peak)
+            {
+                m_columns.push_back((uint32_t)column);
+                m_values.push_back(std::complex<float>(std::conj(value) / (double)fftSize));
+            }
+        }
+
+        m_rowOffsets.push_back(m_columns.size());
+    }
+}
+
+size_t ConstantQKernel::GetNumBins() const
+{
+    return m_numBins;
+}
+
+float ConstantQKernel::GetFrequency(size_t bin) const
+{
+    return m_frequencyLow * std::pow(2.f, (float)bin / m_binsPerOctave);
+}
+
+void ConstantQKernel::Apply(fftwf_complex const* input, fftwf_complex* output) const
+{
+    for (size_t bin = 0; bin < m_numBins; ++bin)
+    {
+        float real = 0.f;
+        float imag = 0.f;
+
+        for (size_t i = m_rowOffsets[bin]; i < m_rowOffsets[bin + 1]; ++i)
+        {
+            fftwf_complex const& x = input[m_columns[i]];
+            std::complex<float> const& k = m_values[i];
+
+            real += k.real() * x[0] - k.imag() * x[1];
+            imag += k.real() * x[1] + k.imag() * x[0];
+        }
+
+        output[bin][0] = real;
+        output[bin][1] = imag;
+    }
+}
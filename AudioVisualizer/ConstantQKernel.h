@@ -0,0 +1,47 @@
+#pragma once
+
+#include <fftw3.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <complex>
+#include <vector>
+
+// Sparse spectral kernel (Brown and Puckette) that turns one FFT of a frame into a constant-Q spectrum with
+// binsPerOctave geometrically spaced bins. Each bin is a Hann-windowed complex exponential spanning the same
+// number of periods, and every window ends where the frame ends so the treble is not delayed by the bass.
+class ConstantQKernel
+{
+public:
+    ConstantQKernel();
+
+    ConstantQKernel(ConstantQKernel const&) = delete;
+    ConstantQKernel(ConstantQKernel&&) = delete;
+
+    ConstantQKernel& operator=(ConstantQKernel const&) = delete;
+    ConstantQKernel& operator=(ConstantQKernel&&) = delete;
+
+    // frame length the longest window, the one of frequencyLow, needs
+    static size_t GetFrameNumSamples(size_t sampleRate, size_t binsPerOctave, float frequencyLow);
+
+    // frequencyLow is raised to what a frame of fftSize can resolve; a sinusoid of amplitude a comes out
+    // with a magnitude of a * scale / 4, the same as a Hann-windowed FFT of scale samples
+    void Reset(size_t sampleRate, size_t fftSize, size_t binsPerOctave, float frequencyLow, float frequencyHigh, float scale);
+
+    size_t GetNumBins() const;
+    float GetFrequency(size_t bin) const;
+
+    // fftSize / 2 + 1 bins of an r2c transform in, GetNumBins() bins out
+    void Apply(fftwf_complex const* input, fftwf_complex* output) const;
+
+private:
+    size_t m_binsPerOctave;
+    float m_frequencyLow;
+    size_t m_numBins;
+
+    // compressed sparse rows, one per bin
+    std::vector<size_t> m_rowOffsets;
+    std::vector<uint32_t> m_columns;
+    std::vector<std::complex<float>> m_values;
+};
@@ -4,42 +4,79 @@
 
 #include <cmath>
 
-inline float EaseLin(float x)
+constexpr float EaseLin(float x)
 {
     return x;
 }
 
 inline float EaseInCirc(float x)
 {
-    return 1.f - std::sqrtf(1.f - std::powf(x, 2.f));
+    return 1.f - std::sqrt(1.f - std::pow(x, 2.f));
 }
 
 inline float EaseOutCirc(float x)
 {
-    return std::sqrtf(1.f - std::powf(x - 1.f, 2.f));
+    return std::sqrt(1.f - std::pow(x - 1.f, 2.f));
 }
 
 inline float EaseInExp(float x)
 {
-    return x <= 0.f ? 0.f : std::powf(2.f, 10.f * x - 10.f);
+    return x <= 0.f ? 0.f : std::pow(2.f, 10.f * x - 10.f);
 }
 
 inline float EaseOutExp(float x)
 {
-    return x >= 1.f ? 1.f : 1.f - std::powf(2.f, -10.f * x);
+    return x >= 1.f ? 1.f : 1.f - std::pow(2.f, -10.f * x);
 }
 
 inline float EaseInSine(float x)
 {
-    return 1.f - std::cosf(x * (float)M_PI / 2.f);
+    return 1.f - std::cos(x * (float)M_PI / 2.f);
 }
 
 inline float EaseOutSine(float x)
 {
-    return std::sinf(x * (float)M_PI / 2.f);
+    return std::sin(x * (float)M_PI / 2.f);
 }
 
-inline float Lerp(float x, float a, float b)
+// the curves as function objects, so templates taking them can inline the curve into their loops; only the linear one
+// can be evaluated at compile time, as the <cmath> functions the others call are not constexpr
+struct EaseLinCurve
+{
+    constexpr float operator()(float x) const { return EaseLin(x); }
+};
+
+struct EaseInCircCurve
+{
+    float operator()(float x) const { return EaseInCirc(x); }
+};
+
+struct EaseOutCircCurve
+{
+    float operator()(float x) const { return EaseOutCirc(x); }
+};
+
+struct EaseInExpCurve
+{
+    float operator()(float x) const { return EaseInExp(x); }
+};
+
+struct EaseOutExpCurve
+{
+    float operator()(float x) const { return EaseOutExp(x); }
+};
+
+struct EaseInSineCurve
+{
+    float operator()(float x) const { return EaseInSine(x); }
+};
+
+struct EaseOutSineCurve
+{
+    float operator()(float x) const { return EaseOutSine(x); }
+};
+
+constexpr float Lerp(float x, float a, float b)
 {
     return (1.f - x) * a + x * b;
 }
@@ -0,0 +1,421 @@
+#include "FFTPlanCache.h"
+
+#include <fftw3.h>
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+
+// below this many samples per execution threads cost more than they save, so they are not even measured
+static int const s_threadingMinNumSamples = 16384;
+
+// executions timed per plan, the fastest of them counting
+static int const s_numTimings = 8;
+
+// how long callers must stop acquiring before the planner is taken for measuring
+static std::chrono::milliseconds const s_measureDelay(1000);
+
+FFTPlanCache::Plan::Plan()
+    : m_plan(nullptr)
+    , m_numThreads(1)
+    , m_estimatedPlan()
+    , m_measuredPlan()
+{
+}
+
+FFTPlanCache::Plan::~Plan()
+{
+    if (m_measuredPlan)
+        fftwf_destroy_plan(m_measuredPlan);
+    if (m_estimatedPlan)
+        fftwf_destroy_plan(m_estimatedPlan);
+}
+
+fftwf_plan FFTPlanCache::Plan::Get() const
+{
+    return m_plan.load(std::memory_order_acquire);
+}
+
+int FFTPlanCache::Plan::GetNumThreads() const
+{
+    return m_numThreads.load(std::memory_order_relaxed);
+}
+
+// fastest of a few executions on arrays of the plan's own, after one to warm the caches
+static double TimePlan(fftwf_plan plan, float* input, fftwf_complex* output)
+{
+    double best = 0.;
+
+    for (int i = 0; i <= s_numTimings; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fftwf_execute_dft_r2c(plan, input, output);
+        double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (i == 1 || (i > 1 && duration < best))
+            best = duration;
+    }
+
+    return best;
+}
+
+FFTPlanCache::FFTPlanCache(std::string const& wisdomPath, unsigned measureFlags, int maxNumThreads)
+    : m_wisdomPath(wisdomPath)
+    , m_numThreadsPath(wisdomPath.empty() ? std::string() : wisdomPath + ".threads")
+    , m_measureFlags(measureFlags)
+    , m_maxNumThreads((std::max)(maxNumThreads, 1))
+    , m_isMeasuring(false)
+{
+    if (!Initialize())
+        std::cerr << "Could not initialize FFTPlanCache" << std::endl;
+}
+
+FFTPlanCache::~FFTPlanCache()
+{
+    if (m_isInitialized)
+        Destroy();
+}
+
+bool FFTPlanCache::Initialize()
+{
+    // http://www.fftw.org/fftw3_doc/Usage-of-Multi_002dthreaded-FFTW.html
+    if (m_maxNumThreads > 1 && !fftwf_init_threads())
+    {
+        std::cerr << "Could not initialize FFTW threads, planning for one" << std::endl;
+        m_maxNumThreads = 1;
+    }
+
+    // plans are made on the render thread, the device reinitialization thread and the measuring thread, all under
+    // m_plannerMutex, so FFTW's own planner lock is left off
+    if (!m_wisdomPath.empty())
+        fftwf_import_wisdom_from_filename(m_wisdomPath.c_str());
+
+    LoadMeasuredNumThreads();
+
+    m_isMeasuring = true;
+
+    try
+    {
+        m_measureThread = std::thread(&FFTPlanCache::MeasureThread, this);
+    }
+    catch (...)
+    {
+        m_isMeasuring = false;
+        goto fail;
+    }
+
+    m_isInitialized = true;
+    return true;
+
+fail:
+    Destroy();
+    return false;
+}
+
+void FFTPlanCache::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isMeasuring = false;
+    }
+    m_measureCondition.notify_one();
+
+    if (m_measureThread.joinable())
+        m_measureThread.join();
+
+    m_plans.clear();
+}
+
+fftwf_plan FFTPlanCache::CreatePlan(Key const& key, float* input, fftwf_complex* output, unsigned flags, int numThreads)
+{
+    int size = std::get<0>(key);
+    int numChannels = std::get<1>(key);
+
+    // planner state, so set for every plan rather than put back after the threaded ones
+    if (m_maxNumThreads > 1)
+        fftwf_plan_with_nthreads(numThreads);
+
+    // http://www.fftw.org/fftw3_doc/Advanced-Real_002ddata-DFTs.html
+    return fftwf_plan_many_dft_r2c(1, &size, numChannels,
+        input, nullptr, 1, size,
+        output, nullptr, 1, size / 2 + 1,
+        flags);
+}
+
+bool FFTPlanCache::CreateFirstPlan(Key const& key, Plan* plan, float* input, fftwf_complex* output, int numThreads)
+{
+    // a size measured in an earlier run comes straight out of wisdom without touching the arrays
+    if (numThreads > 1)
+    {
+        plan->m_measuredPlan = CreatePlan(key, input, output, m_measureFlags | FFTW_WISDOM_ONLY, numThreads);
+        if (plan->m_measuredPlan)
+            plan->m_numThreads.store(numThreads, std::memory_order_relaxed);
+    }
+
+    if (!plan->m_measuredPlan)
+        plan->m_measuredPlan = CreatePlan(key, input, output, m_measureFlags | FFTW_WISDOM_ONLY, 1);
+
+    if (!plan->m_measuredPlan)
+    {
+        plan->m_estimatedPlan = CreatePlan(key, input, output, FFTW_ESTIMATE, 1);
+        if (!plan->m_estimatedPlan)
+            return false;
+    }
+
+    plan->m_plan.store(plan->m_measuredPlan ? plan->m_measuredPlan : plan->m_estimatedPlan, std::memory_order_release);
+    return true;
+}
+
+bool FFTPlanCache::IsMeasured(Key const& key, Plan const* plan, int numThreads) const
+{
+    // large sizes whose thread count was never timed are timed once
+    return plan->m_measuredPlan &&
+        (numThreads > 0 ? plan->GetNumThreads() == numThreads : !IsThreadingWorthMeasuring(key));
+}
+
+bool FFTPlanCache::IsThreadingWorthMeasuring(Key const& key) const
+{
+    return m_maxNumThreads > 1 && (long long)std::get<0>(key) * std::get<1>(key) >= s_threadingMinNumSamples;
+}
+
+void FFTPlanCache::LoadMeasuredNumThreads()
+{
+    if (m_numThreadsPath.empty())
+        return;
+
+    std::ifstream file(m_numThreadsPath);
+
+    int size, numChannels, inputAlignment, outputAlignment, numThreads;
+    while (file >> size >> numChannels >> inputAlignment >> outputAlignment >> numThreads)
+        m_measuredNumThreads[Key(size, numChannels, inputAlignment, outputAlignment)] = numThreads;
+}
+
+void FFTPlanCache::SaveMeasuredNumThreads() const
+{
+    if (m_numThreadsPath.empty())
+        return;
+
+    std::ofstream file(m_numThreadsPath, std::ios::trunc);
+
+    for (auto const& measured : m_measuredNumThreads)
+    {
+        Key const& key = measured.first;
+        file << std::get<0>(key) << ' ' << std::get<1>(key) << ' ' << std::get<2>(key) << ' ' << std::get<3>(key) << ' '
+            << measured.second << '\n';
+    }
+
+    if (!file)
+        std::cerr << "Could not save FFT thread counts to " << m_numThreadsPath << std::endl;
+}
+
+int FFTPlanCache::GetMeasuredNumThreads(Key const& key) const
+{
+    auto it = m_measuredNumThreads.find(key);
+    if (it == m_measuredNumThreads.end())
+        return 0;
+
+    // timed against a different thread limit, on another machine or with other settings
+    if (it->second != 1 && it->second != m_maxNumThreads)
+        return 0;
+
+    return it->second;
+}
+
+FFTPlanCache::Plan const* FFTPlanCache::Acquire(int size, int numChannels, float* input, fftwf_complex* output)
+{
+    Key key(size, numChannels, fftwf_alignment_of(input), fftwf_alignment_of((float*)output));
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_lastAcquireTime = std::chrono::steady_clock::now();
+
+    auto it = m_plans.find(key);
+    if (it != m_plans.end())
+        return it->second.get();
+
+    Plan* plan = m_plans.emplace(key, std::unique_ptr<Plan>(new Plan())).first->second.get();
+    int numThreads = GetMeasuredNumThreads(key);
+
+    lock.unlock();
+
+    // a measurement may hold the planner for seconds, so rather than waiting the first plan is left to the
+    // measuring thread, which makes it before measuring anything else
+    std::unique_lock<std::mutex> plannerLock(m_plannerMutex, std::try_to_lock);
+    if (!plannerLock)
+    {
+        lock.lock();
+        m_planQueue.push_back(key);
+        m_measureCondition.notify_one();
+        return plan;
+    }
+
+    bool isPlanned = CreateFirstPlan(key, plan, input, output, numThreads);
+    plannerLock.unlock();
+
+    if (!isPlanned)
+        return nullptr;
+
+    if (!IsMeasured(key, plan, numThreads))
+    {
+        lock.lock();
+        m_measureQueue.push_back(key);
+        m_measureCondition.notify_one();
+    }
+
+    return plan;
+}
+
+void FFTPlanCache::MeasureThread()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (;;)
+    {
+        m_measureCondition.wait(lock, [this] { return !m_isMeasuring || !m_planQueue.empty() || !m_measureQueue.empty(); });
+        if (!m_isMeasuring)
+            break;
+
+        bool isFirstPlan = !m_planQueue.empty();
+
+        // callers make their first plans in bursts, all of which should be made before measuring takes the planner
+        auto measureTime = m_lastAcquireTime + s_measureDelay;
+        if (!isFirstPlan && std::chrono::steady_clock::now() < measureTime)
+        {
+            m_measureCondition.wait_until(lock, measureTime);
+            continue;
+        }
+
+        std::deque<Key>& queue = isFirstPlan ? m_planQueue : m_measureQueue;
+        Key key = queue.front();
+        queue.pop_front();
+
+        Plan* plan = m_plans[key].get();
+        int measuredNumThreads = GetMeasuredNumThreads(key);
+
+        lock.unlock();
+
+        int size = std::get<0>(key);
+        int numChannels = std::get<1>(key);
+
+        // measuring overwrites the arrays, so it gets its own; fftwf_alloc gives the same alignment the callers use
+        float* input = fftwf_alloc_real((size_t)size * numChannels);
+        fftwf_complex* output = fftwf_alloc_complex((size_t)(size / 2 + 1) * numChannels);
+
+        bool isAligned = input && output &&
+            fftwf_alignment_of(input) == std::get<2>(key) && fftwf_alignment_of((float*)output) == std::get<3>(key);
+
+        if (isFirstPlan)
+        {
+            bool isPlanned = false;
+            if (isAligned)
+            {
+                std::lock_guard<std::mutex> plannerLock(m_plannerMutex);
+                isPlanned = CreateFirstPlan(key, plan, input, output, measuredNumThreads);
+            }
+
+            if (output)
+                fftwf_free(output);
+            if (input)
+                fftwf_free(input);
+
+            lock.lock();
+
+            if (!isPlanned)
+                std::cerr << "Could not plan FFTs of size " << size << std::endl;
+            else if (!IsMeasured(key, plan, measuredNumThreads))
+                m_measureQueue.push_back(key);
+
+            continue;
+        }
+
+        fftwf_plan measuredPlan = nullptr;
+        int numThreads = 1;
+        bool isTimed = false;
+
+        if (isAligned)
+        {
+            // timed in an earlier run, the wisdom most likely has this plan already
+            if (measuredNumThreads > 1)
+                numThreads = measuredNumThreads;
+
+            // the planner is released between the plans, so first plans callers are waiting for get in
+            {
+                std::lock_guard<std::mutex> plannerLock(m_plannerMutex);
+                measuredPlan = CreatePlan(key, input, output, m_measureFlags, numThreads);
+            }
+
+            if (measuredPlan && measuredNumThreads == 0 && IsThreadingWorthMeasuring(key))
+            {
+                fftwf_plan threadedPlan = nullptr;
+                {
+                    std::lock_guard<std::mutex> plannerLock(m_plannerMutex);
+                    threadedPlan = CreatePlan(key, input, output, m_measureFlags, m_maxNumThreads);
+                }
+
+                // planning left the arrays with whatever it measured on
+                std::fill(input, input + (size_t)size * numChannels, 0.f);
+
+                isTimed = threadedPlan != nullptr;
+
+                if (threadedPlan && TimePlan(threadedPlan, input, output) < TimePlan(measuredPlan, input, output))
+                {
+                    std::swap(measuredPlan, threadedPlan);
+                    numThreads = m_maxNumThreads;
+                }
+
+                if (threadedPlan)
+                {
+                    std::lock_guard<std::mutex> plannerLock(m_plannerMutex);
+                    fftwf_destroy_plan(threadedPlan);
+                }
+            }
+        }
+
+        if (output)
+            fftwf_free(output);
+        if (input)
+            fftwf_free(input);
+
+        if (measuredPlan)
+        {
+            std::lock_guard<std::mutex> plannerLock(m_plannerMutex);
+
+            if (!m_wisdomPath.empty())
+                fftwf_export_wisdom_to_filename(m_wisdomPath.c_str());
+
+            // a plan from wisdom on as many threads is as good as the one just made
+            if (plan->m_measuredPlan && numThreads == plan->GetNumThreads())
+            {
+                fftwf_destroy_plan(measuredPlan);
+            }
+            else
+            {
+                // the estimated plan, or the one from wisdom in its place, may still be executing on another thread,
+                // so it is kept until the cache goes away
+                if (plan->m_measuredPlan)
+                    plan->m_estimatedPlan = plan->m_measuredPlan;
+
+                plan->m_measuredPlan = measuredPlan;
+                plan->m_numThreads.store(numThreads, std::memory_order_relaxed);
+                plan->m_plan.store(measuredPlan, std::memory_order_release);
+            }
+        }
+
+        lock.lock();
+
+        if (isTimed)
+        {
+            m_measuredNumThreads[key] = numThreads;
+            SaveMeasuredNumThreads();
+        }
+    }
+}
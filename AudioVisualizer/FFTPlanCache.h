@@ -0,0 +1,121 @@
+#pragma once
+
+#include "IInitializable.h"
+
+#include <fftw3.h>
+
+#include <stddef.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+
+// Batched real-to-complex FFTW plans shared across device changes. A new size
+// is planned with FFTW_ESTIMATE right away (or from wisdom if it was measured
+// before) and measured on a background thread, which swaps the tuned plan in
+// when it is ready. Measuring waits until callers have stopped acquiring for a
+// moment, and callers never wait for a measurement: if one holds the planner,
+// their first plan is made on the background thread as soon as it lets go.
+// Wisdom is loaded on creation and saved whenever a plan is measured. With
+// more than one thread allowed, large sizes are also planned for FFTW's
+// threads, and the measuring thread times both plans once and keeps the
+// faster one; the thread count that won is saved next to the wisdom, so later
+// runs take that plan from wisdom without timing again. Plans are executed
+// with fftwf_execute_dft_r2c() on the caller's arrays and stay alive as long
+// as the cache.
+class FFTPlanCache : public IInitializable
+{
+public:
+    class Plan
+    {
+        friend class FFTPlanCache;
+
+    public:
+        Plan();
+
+        Plan(Plan const&) = delete;
+        Plan(Plan&&) = delete;
+
+        Plan& operator=(Plan const&) = delete;
+        Plan& operator=(Plan&&) = delete;
+
+        ~Plan();
+
+        // the best plan so far, may change between calls; null until the first one is made
+        fftwf_plan Get() const;
+        // threads the best plan so far executes on
+        int GetNumThreads() const;
+
+    private:
+        std::atomic<fftwf_plan> m_plan;
+        std::atomic<int> m_numThreads;
+        fftwf_plan m_estimatedPlan;
+        fftwf_plan m_measuredPlan;
+    };
+
+    // maxNumThreads above 1 initializes FFTW's threads, falling back to a single thread if that fails
+    FFTPlanCache(std::string const& wisdomPath = std::string(), unsigned measureFlags = FFTW_MEASURE, int maxNumThreads = 1);
+
+    FFTPlanCache(FFTPlanCache const&) = delete;
+    FFTPlanCache(FFTPlanCache&&) = delete;
+
+    FFTPlanCache& operator=(FFTPlanCache const&) = delete;
+    FFTPlanCache& operator=(FFTPlanCache&&) = delete;
+
+    virtual ~FFTPlanCache() override;
+
+    // numChannels transforms of size samples each, laid out back to back; input and output only decide the alignment.
+    // Null only if the size cannot be planned.
+    Plan const* Acquire(int size, int numChannels, float* input, fftwf_complex* output);
+
+private:
+    // size, channel count, input and output alignment
+    typedef std::tuple<int, int, int, int> Key;
+
+    bool Initialize() override;
+    void Destroy() override;
+
+    void MeasureThread();
+
+    // thread counts timed in earlier runs, one "size channels alignments threads" line per key
+    void LoadMeasuredNumThreads();
+    void SaveMeasuredNumThreads() const;
+    // 0 for a key that was not timed with the current thread limit
+    int GetMeasuredNumThreads(Key const& key) const;
+
+    // these two need m_plannerMutex held
+    fftwf_plan CreatePlan(Key const& key, float* input, fftwf_complex* output, unsigned flags, int numThreads);
+    // from wisdom on numThreads, or on one thread, or estimated
+    bool CreateFirstPlan(Key const& key, Plan* plan, float* input, fftwf_complex* output, int numThreads);
+
+    bool IsMeasured(Key const& key, Plan const* plan, int numThreads) const;
+    bool IsThreadingWorthMeasuring(Key const& key) const;
+
+    std::string m_wisdomPath;
+    std::string m_numThreadsPath;
+    unsigned m_measureFlags;
+    int m_maxNumThreads;
+
+    // every planner call, as the planner and its thread count are shared by every thread
+    std::mutex m_plannerMutex;
+
+    std::mutex m_mutex;
+    std::map<Key, std::unique_ptr<Plan>> m_plans;
+    // written by the measuring thread under m_mutex
+    std::map<Key, int> m_measuredNumThreads;
+
+    std::thread m_measureThread;
+    std::condition_variable m_measureCondition;
+    // first plans callers did not wait for go before any measurement
+    std::deque<Key> m_planQueue;
+    std::deque<Key> m_measureQueue;
+    std::chrono::steady_clock::time_point m_lastAcquireTime;
+    bool m_isMeasuring;
+};
@@ -0,0 +1,87 @@
+#include "FrequencyDistribution.h"
+
+#include "Easing.h"
+
+#include <stddef.h>
+
+#include <vector>
+
+template <typename Curve>
+static float Distribute(float x)
+{
+    return Curve()(x);
+}
+
+template <typename Curve>
+static void DistributeFrequencies(float const* frequencies, size_t count, float frequencyLow, float frequencyHigh, float* positions)
+{
+    Curve curve;
+
+    // an empty range puts everything on its start
+    float scale = frequencyHigh > frequencyLow ? 1.f / (frequencyHigh - frequencyLow) : 0.f;
+
+    for (size_t i = 0; i < count; ++i)
+        positions[i] = curve((frequencies[i] - frequencyLow) * scale);
+}
+
+template <typename Curve>
+static void DistributeBins(size_t numBins, float* positions)
+{
+    Curve curve;
+
+    float last = numBins > 1 ? (float)(numBins - 1) : 1.f;
+
+    // divided rather than multiplied by a reciprocal so the last bin lands exactly on 1
+    for (size_t bin = 0; bin < numBins; ++bin)
+        positions[bin] = curve(bin / last);
+}
+
+template <typename Curve>
+static void InvertBins(size_t numBins, float* positions)
+{
+    Curve curve;
+
+    float last = numBins > 1 ? (float)(numBins - 1) : 1.f;
+
+    // the curves are rising but have no inverse to call, so bisect for where they reach every bin; the steps
+    // run across all bins at once, which keeps the inner loop free of branches
+    std::vector<float> lows(numBins, 0.f);
+
+    for (size_t bin = 0; bin < numBins; ++bin)
+        positions[bin] = 1.f;
+
+    for (int i = 0; i < 24; ++i)
+    {
+        for (size_t bin = 0; bin < numBins; ++bin)
+        {
+            float middle = (lows[bin] + positions[bin]) / 2.f;
+            bool isBelow = curve(middle) < bin / last;
+
+            lows[bin] = isBelow ? middle : lows[bin];
+            positions[bin] = isBelow ? positions[bin] : middle;
+        }
+    }
+}
+
+template <typename Curve>
+static FrequencyDistributionKernels MakeKernels()
+{
+    return { Distribute<Curve>, DistributeFrequencies<Curve>, DistributeBins<Curve>, InvertBins<Curve> };
+}
+
+// indexed by FrequencyDistribution
+static FrequencyDistributionKernels const s_kernels[] =
+{
+    MakeKernels<EaseLinCurve>(),
+    MakeKernels<EaseInCircCurve>(),
+    MakeKernels<EaseOutCircCurve>(),
+    MakeKernels<EaseInExpCurve>(),
+    MakeKernels<EaseOutExpCurve>(),
+    MakeKernels<EaseInSineCurve>(),
+    MakeKernels<EaseOutSineCurve>(),
+};
+
+FrequencyDistributionKernels const& GetFrequencyDistributionKernels(FrequencyDistribution distribution)
+{
+    return s_kernels[(size_t)distribution];
+}
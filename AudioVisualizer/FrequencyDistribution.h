@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+// Easing curve the bins are spread over the frequency range along.
+enum class FrequencyDistribution
+{
+    Linear,
+    InCirc,
+    OutCirc,
+    InExp,
+    OutExp,
+    InSine,
+    OutSine,
+};
+
+// The loops that evaluate a distribution, instantiated for every curve so it is inlined into them rather than
+// called through a pointer for every element.
+struct FrequencyDistributionKernels
+{
+    float (*distribute)(float x);
+
+    // position, from 0 to 1, of each of count frequencies between frequencyLow and frequencyHigh
+    void (*distributeFrequencies)(float const* frequencies, size_t count, float frequencyLow, float frequencyHigh, float* positions);
+
+    // position of each of numBins evenly spaced bins
+    void (*distributeBins)(size_t numBins, float* positions);
+
+    // where in the frequency range, from 0 to 1, each of numBins evenly spaced bins is reached
+    void (*invertBins)(size_t numBins, float* positions);
+};
+
+FrequencyDistributionKernels const& GetFrequencyDistributionKernels(FrequencyDistribution distribution);
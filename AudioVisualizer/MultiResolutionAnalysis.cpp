@@ -0,0 +1,221 @@
+#include "MultiResolutionAnalysis.h"
+
+#include <fftw3.h>
+
+#include <stddef.h>
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+static double const s_pi = 3.14159265358979323846;
+
+// each stage keeps a quarter of the band, Blackman-windowed so aliases stay below about -70 dB
+static size_t const s_decimation = 4;
+static size_t const s_filterNumTaps = 64;
+
+// bass, mids and treble, from the most decimated level to the full rate
+static size_t const s_bandLevels[] = { 2, 1, 0 };
+static size_t const s_bandFFTSizes[] = { 1024, 1024, 512 };
+
+// a decimated band is flat up to this fraction of its rate
+static float const s_bandFlatness = 0.3f;
+
+MultiResolutionAnalysis::MultiResolutionAnalysis()
+    : m_numChannels()
+{
+    for (Band& band : m_bands)
+    {
+        band.level = 0;
+        band.fftSize = 0;
+        band.scale = 0.f;
+        band.input = nullptr;
+        band.output = nullptr;
+        band.plan = nullptr;
+    }
+}
+
+MultiResolutionAnalysis::~MultiResolutionAnalysis()
+{
+    Destroy();
+}
+
+bool MultiResolutionAnalysis::Reset(FFTPlanCache* fftPlanCache, size_t sampleRate, size_t numChannels, WindowFunctionType windowType,
+    float crossoverLow, float crossoverHigh, float scale)
+{
+    size_t numLevels = s_bandLevels[0] + 1;
+
+    Destroy();
+
+    m_numChannels = numChannels;
+
+    m_filter.resize(s_filterNumTaps);
+
+    double filterSum = 0.;
+    for (size_t k = 0; k < s_filterNumTaps; ++k)
+    {
+        double x = k - (s_filterNumTaps - 1) / 2.;
+        double sinc = x == 0. ? 1. : std::sin(s_pi * x / s_decimation) / (s_pi * x / s_decimation);
+        double blackman = 0.42 - 0.5 * std::cos(2. * s_pi * k / (s_filterNumTaps - 1)) + 0.08 * std::cos(4. * s_pi * k / (s_filterNumTaps - 1));
+
+        m_filter[k] = (float)(sinc * blackman);
+        filterSum += m_filter[k];
+    }
+
+    for (float& tap : m_filter)
+        tap = (float)(tap / filterSum);
+
+    // every level feeds the next one and its own band, working back from the most decimated one
+    m_levelNumSamples.assign(numLevels, 0);
+
+    for (size_t band = 0; band < 3; ++band)
+        m_levelNumSamples[s_bandLevels[band]] = s_bandFFTSizes[band];
+
+    for (size_t level = numLevels - 1; level-- > 0;)
+        m_levelNumSamples[level] = (std::max)(m_levelNumSamples[level], s_decimation * (m_levelNumSamples[level + 1] - 1) + s_filterNumTaps);
+
+    m_levels.resize(numLevels);
+    for (size_t level = 1; level < numLevels; ++level)
+        m_levels[level].resize(m_levelNumSamples[level]);
+
+    crossoverLow = (std::min)(crossoverLow, s_bandFlatness * sampleRate / std::pow((float)s_decimation, (float)s_bandLevels[0]));
+    crossoverHigh = (std::min)((std::max)(crossoverHigh, crossoverLow), s_bandFlatness * sampleRate / std::pow((float)s_decimation, (float)s_bandLevels[1]));
+
+    float bandLow[] = { 0.f, crossoverLow, crossoverHigh };
+    float bandHigh[] = { crossoverLow, crossoverHigh, sampleRate / 2.f + 1.f };
+
+    m_bins.clear();
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        Band& band = m_bands[i];
+
+        band.level = s_bandLevels[i];
+        band.fftSize = s_bandFFTSizes[i];
+        band.scale = scale / band.fftSize;
+
+        band.window.Reset(windowType, band.fftSize);
+
+        band.input = fftwf_alloc_real(m_numChannels * band.fftSize);
+        band.output = fftwf_alloc_complex(m_numChannels * (band.fftSize / 2 + 1));
+        if (!band.input || !band.output)
+            return false;
+
+        band.plan = fftPlanCache->Acquire((int)band.fftSize, (int)m_numChannels, band.input, band.output);
+        if (!band.plan)
+            return false;
+
+        float bandRate = sampleRate / std::pow((float)s_decimation, (float)band.level);
+
+        for (size_t index = 0; index <= band.fftSize / 2; ++index)
+        {
+            float frequency = index * bandRate / band.fftSize;
+
+            if (frequency >= bandLow[i] && frequency < bandHigh[i])
+                m_bins.push_back({ i, index, frequency });
+        }
+    }
+
+    return true;
+}
+
+void MultiResolutionAnalysis::Destroy()
+{
+    for (Band& band : m_bands)
+    {
+        if (band.output)
+            fftwf_free(band.output);
+        if (band.input)
+            fftwf_free(band.input);
+
+        band.plan = nullptr;
+        band.output = nullptr;
+        band.input = nullptr;
+    }
+}
+
+void MultiResolutionAnalysis::SetWindowFunction(WindowFunctionType type)
+{
+    for (Band& band : m_bands)
+        band.window.Reset(type, band.fftSize);
+}
+
+size_t MultiResolutionAnalysis::GetFrameNumSamples() const
+{
+    return m_levelNumSamples.empty() ? 0 : m_levelNumSamples[0];
+}
+
+size_t MultiResolutionAnalysis::GetNumBins() const
+{
+    return m_bins.size();
+}
+
+float MultiResolutionAnalysis::GetFrequency(size_t bin) const
+{
+    return m_bins[bin].frequency;
+}
+
+bool MultiResolutionAnalysis::IsPlanned() const
+{
+    for (Band const& band : m_bands)
+    {
+        if (!band.plan->Get())
+            return false;
+    }
+
+    return true;
+}
+
+void MultiResolutionAnalysis::Apply(float const* const* frames, fftwf_complex* output)
+{
+    for (size_t channel = 0; channel < m_numChannels; ++channel)
+    {
+        for (size_t level = 1; level < m_levels.size(); ++level)
+        {
+            float const* input = level == 1 ? frames[channel] : m_levels[level - 1].data();
+            Decimate(input, m_levelNumSamples[level - 1], m_levels[level].data(), m_levelNumSamples[level]);
+        }
+
+        // every band ends where the frame ends
+        for (Band& band : m_bands)
+        {
+            float const* data = band.level == 0 ? frames[channel] : m_levels[band.level].data();
+            band.window.Apply(data + m_levelNumSamples[band.level] - band.fftSize, band.input + channel * band.fftSize);
+        }
+    }
+
+    for (Band& band : m_bands)
+        fftwf_execute_dft_r2c(band.plan->Get(), band.input, band.output);
+
+    size_t numBins = m_bins.size();
+
+    for (size_t channel = 0; channel < m_numChannels; ++channel)
+    {
+        for (size_t bin = 0; bin < numBins; ++bin)
+        {
+            Band const& band = m_bands[m_bins[bin].band];
+            fftwf_complex const& value = band.output[channel * (band.fftSize / 2 + 1) + m_bins[bin].index];
+
+            output[channel * numBins + bin][0] = value[0] * band.scale;
+            output[channel * numBins + bin][1] = value[1] * band.scale;
+        }
+    }
+}
+
+void MultiResolutionAnalysis::Decimate(float const* input, size_t numInputSamples, float* output, size_t numOutputSamples) const
+{
+    // the last output sample takes the last input samples
+    input += numInputSamples - (s_decimation * (numOutputSamples - 1) + s_filterNumTaps);
+
+    for (size_t i = 0; i < numOutputSamples; ++i)
+    {
+        float const* samples = input + i * s_decimation;
+        float sum = 0.f;
+
+        for (size_t k = 0; k < s_filterNumTaps; ++k)
+            sum += m_filter[k] * samples[k];
+
+        output[i] = sum;
+    }
+}
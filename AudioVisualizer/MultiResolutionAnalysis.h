@@ -0,0 +1,82 @@
+#pragma once
+
+#include "FFTPlanCache.h"
+#include "WindowFunction.h"
+
+#include <fftw3.h>
+
+#include <stddef.h>
+
+#include <vector>
+
+// Three FFTs of the same frame at different resolutions: a long one over a 16x decimated signal for the bass,
+// a medium one over a 4x decimated signal for the mids and a short one at the full rate for the treble, stitched
+// into one spectrum at two crossover frequencies. Decimation is a cascade of 4x FIR stages, so the bass gets a
+// window of a third of a second for little more than the cost of a medium FFT.
+class MultiResolutionAnalysis
+{
+public:
+    MultiResolutionAnalysis();
+
+    MultiResolutionAnalysis(MultiResolutionAnalysis const&) = delete;
+    MultiResolutionAnalysis(MultiResolutionAnalysis&&) = delete;
+
+    MultiResolutionAnalysis& operator=(MultiResolutionAnalysis const&) = delete;
+    MultiResolutionAnalysis& operator=(MultiResolutionAnalysis&&) = delete;
+
+    ~MultiResolutionAnalysis();
+
+    // crossovers are clamped to where the decimated bands are still flat; a sinusoid of amplitude a comes out
+    // with the magnitude a Hann-windowed FFT of scale samples would give it
+    bool Reset(FFTPlanCache* fftPlanCache, size_t sampleRate, size_t numChannels, WindowFunctionType windowType,
+        float crossoverLow, float crossoverHigh, float scale);
+    void Destroy();
+
+    void SetWindowFunction(WindowFunctionType type);
+
+    // samples each channel's frame has to hold, the bands all end where it ends
+    size_t GetFrameNumSamples() const;
+
+    size_t GetNumBins() const;
+    float GetFrequency(size_t bin) const;
+
+    // whether every band has a plan yet, which Apply() needs
+    bool IsPlanned() const;
+
+    // one frame per channel in, GetNumBins() complex bins per channel out
+    void Apply(float const* const* frames, fftwf_complex* output);
+
+private:
+    struct Band
+    {
+        // in 4x decimation stages
+        size_t level;
+        size_t fftSize;
+        float scale;
+
+        WindowFunction window;
+        float* input;
+        fftwf_complex* output;
+        FFTPlanCache::Plan const* plan;
+    };
+
+    // a stitched bin, taken from one band
+    struct Bin
+    {
+        size_t band;
+        size_t index;
+        float frequency;
+    };
+
+    void Decimate(float const* input, size_t numInputSamples, float* output, size_t numOutputSamples) const;
+
+    size_t m_numChannels;
+
+    std::vector<float> m_filter;
+    Band m_bands[3];
+    std::vector<Bin> m_bins;
+
+    // samples needed at each level, and the decimated signals of one channel
+    std::vector<size_t> m_levelNumSamples;
+    std::vector<std::vector<float>> m_levels;
+};
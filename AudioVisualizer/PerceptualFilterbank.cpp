@@ -0,0 +1,124 @@
+#include "PerceptualFilterbank.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+// O'Shaughnessy's mel scale
+static double ToMel(double frequency)
+{
+    return 2595. * std::log10(1. + frequency / 700.);
+}
+
+static double FromMel(double mel)
+{
+    return 700. * (std::pow(10., mel / 2595.) - 1.);
+}
+
+// Traunmuller's approximation of the Bark scale
+static double ToBark(double frequency)
+{
+    return 26.81 * frequency / (1960. + frequency) - 0.53;
+}
+
+static double FromBark(double bark)
+{
+    return 1960. * (bark + 0.53) / (26.28 - bark);
+}
+
+PerceptualFilterbank::PerceptualFilterbank()
+{
+}
+
+void PerceptualFilterbank::Reset(PerceptualScale scale, size_t numBands, float frequencyLow, float frequencyHigh, std::vector<float> const& entryFrequencies)
+{
+    m_frequencies.clear();
+    m_rowOffsets.assign(1, 0);
+    m_columns.clear();
+    m_values.clear();
+
+    if (scale == PerceptualScale::None || numBands == 0 || entryFrequencies.empty())
+        return;
+
+    double (*to)(double) = scale == PerceptualScale::Mel ? ToMel : ToBark;
+    double (*from)(double) = scale == PerceptualScale::Mel ? FromMel : FromBark;
+
+    double low = to(frequencyLow);
+    double high = to(frequencyHigh);
+
+    // every band rises from the center of the one below and falls to the center of the one above
+    std::vector<double> edges(numBands + 2);
+    for (size_t i = 0; i < edges.size(); ++i)
+        edges[i] = from(low + (high - low) * i / (numBands + 1));
+
+    size_t numEntries = entryFrequencies.size();
+    size_t first = 0;
+
+    for (size_t band = 0; band < numBands; ++band)
+    {
+        double left = edges[band];
+        double center = edges[band + 1];
+        double right = edges[band + 2];
+
+        m_frequencies.push_back((float)center);
+
+        while (first < numEntries && entryFrequencies[first] <= left)
+            ++first;
+
+        size_t rowOffset = m_columns.size();
+
+        for (size_t entry = first; entry < numEntries && entryFrequencies[entry] < right; ++entry)
+        {
+            double frequency = entryFrequencies[entry];
+            double weight = frequency < center ? (frequency - left) / (center - left) : (right - frequency) / (right - center);
+
+            m_columns.push_back((uint32_t)entry);
+            m_values.push_back((float)weight);
+        }
+
+        if (m_columns.size() == rowOffset)
+        {
+            size_t nearest = std::lower_bound(entryFrequencies.begin(), entryFrequencies.end(), (float)center) - entryFrequencies.begin();
+            if (nearest == numEntries || (nearest > 0 && center - entryFrequencies[nearest - 1] < entryFrequencies[nearest] - center))
+                --nearest;
+
+            m_columns.push_back((uint32_t)nearest);
+            m_values.push_back(1.f);
+        }
+
+        m_rowOffsets.push_back(m_columns.size());
+    }
+}
+
+size_t PerceptualFilterbank::GetNumBands() const
+{
+    return m_frequencies.size();
+}
+
+float PerceptualFilterbank::GetFrequency(size_t band) const
+{
+    return m_frequencies[band];
+}
+
+float PerceptualFilterbank::Apply(float const* power, float* bands) const
+{
+    size_t numBands = m_frequencies.size();
+    float max = 0.f;
+
+    for (size_t band = 0; band < numBands; ++band)
+    {
+        float sum = 0.f;
+
+        for (size_t i = m_rowOffsets[band]; i < m_rowOffsets[band + 1]; ++i)
+            sum += m_values[i] * power[m_columns[i]];
+
+        bands[band] = sum;
+        max = std::fmax(max, sum);
+    }
+
+    return max;
+}
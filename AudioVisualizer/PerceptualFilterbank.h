@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Which perceptual scale the bands are spaced evenly on, if any.
+enum class PerceptualScale
+{
+    None,
+    Mel,
+    Bark,
+};
+
+// Triangular bands spaced evenly on a perceptual scale, each summing the power of the spectrum entries under it
+// weighted by its triangle. The weights are a sparse matrix in compressed rows precomputed from the frequencies
+// of the entries, so spectra of any layout can be reduced, and a band too narrow to cover any entry takes the
+// one nearest to its center.
+class PerceptualFilterbank
+{
+public:
+    PerceptualFilterbank();
+
+    PerceptualFilterbank(PerceptualFilterbank const&) = delete;
+    PerceptualFilterbank(PerceptualFilterbank&&) = delete;
+
+    PerceptualFilterbank& operator=(PerceptualFilterbank const&) = delete;
+    PerceptualFilterbank& operator=(PerceptualFilterbank&&) = delete;
+
+    // entryFrequencies are those of the spectrum entries, rising
+    void Reset(PerceptualScale scale, size_t numBands, float frequencyLow, float frequencyHigh, std::vector<float> const& entryFrequencies);
+
+    size_t GetNumBands() const;
+    float GetFrequency(size_t band) const;
+
+    // power spectrum in, band powers out; returns the largest of them
+    float Apply(float const* power, float* bands) const;
+
+private:
+    std::vector<float> m_frequencies;
+
+    // compressed sparse rows, one per band
+    std::vector<size_t> m_rowOffsets;
+    std::vector<uint32_t> m_columns;
+    std::vector<float> m_values;
+};
@@ -3,7 +3,6 @@
 #include "AudioCapture.h"
 #include "AudioTransform.h"
 #include "Easing.h"
-#include "Window.h"
 
 #include <SDL.h>
 
@@ -17,19 +16,43 @@
 #include <vector>
 #include <utility>
 
-Plot::Plot(Window* window)
-    : m_window(window)
+// how many levels the bin colors are quantized to
+#define BIN_COLOR_NUM_LEVELS 64
+
+// corners of a quad are laid out clockwise from the top left
+static void SetQuadHorizontal(SDL_Vertex* quad, float x, float w)
+{
+    quad[0].position.x = quad[3].position.x = x;
+    quad[1].position.x = quad[2].position.x = x + w;
+}
+
+static void SetQuadVertical(SDL_Vertex* quad, float y, float h)
+{
+    quad[0].position.y = quad[1].position.y = y;
+    quad[2].position.y = quad[3].position.y = y + h;
+}
+
+static void SetQuadColor(SDL_Vertex* quad, SDL_Color color)
+{
+    for (int i = 0; i < 4; ++i)
+        quad[i].color = color;
+}
+
+Plot::Plot(AudioTransform* audioTransform, int width, int height)
+    : m_audioTransform(audioTransform)
+    , m_width(width)
+    , m_height(height)
     , m_color(255, 255, 255)
     , m_binSpacing(2.f)
-    , m_binColorLow(171, 43, 98)
-    , m_binColorHigh(82, 107, 238)
+    , m_binColorStops({ { 0.f, { 171, 43, 98 } }, { 1.f, { 82, 107, 238 } } })
     , m_hatHeight(4.f)
     , m_hatBinSpacing(1.f)
     , m_frequencyLow(20)
     , m_frequencyHigh(20000)
-    , m_frequencyDistribution(EaseOutExp)
+    , m_frequencyDistribution(FrequencyDistribution::OutExp)
     , m_binLevelSmoothness(0.96f)
     , m_hatGravity(0.75f)
+    , m_barKernel(SelectBarKernel())
 {
     CalculateBinValues();
     CalculateSpectrumValues();
@@ -37,138 +60,99 @@ Plot::Plot(Window* window)
 
 size_t Plot::GetNumBins() const
 {
-    return m_bins.size();
+    return m_binLevels.size();
 }
 
 float Plot::GetBinLevel(size_t bin) const
 {
-    return m_bins[bin].h / m_binHeightMax;
+    return m_binLevels[bin];
 }
 
 float Plot::GetHatLevel(size_t bin) const
 {
-    return 1.f - (m_hats[bin].y - m_binSpacing) / m_binHeightMax;
+    return m_hatLevels[bin];
 }
 
-void Plot::SetBinLevel(size_t bin, float level)
+FrequencyDistribution Plot::GetFrequencyDistribution() const
 {
-    m_bins[bin].y = m_binSpacing + (m_hatHeight + m_hatBinSpacing) + m_binHeightMax * (1.f - level);
-    m_bins[bin].h = m_binHeightMax * level;
+    return m_frequencyDistribution;
 }
 
-void Plot::SetHatLevel(size_t bin, float level)
+void Plot::SetFrequencyDistribution(FrequencyDistribution distribution)
 {
-    m_hats[bin].y = m_binSpacing + m_binHeightMax * (1.f - level);
+    m_frequencyDistribution = distribution;
+
+    CalculateBinColors();
+    CalculateBinGeometry();
 }
 
-size_t Plot::CalculateSpectrumBin(size_t spectrum)
+void Plot::SetAudioTransform(AudioTransform* audioTransform)
 {
-    return (size_t)std::roundf((GetNumBins() - 1) * m_frequencyDistribution((float)(spectrum - m_spectrumLow) / (m_spectrumHigh - m_spectrumLow)));
+    m_audioTransform = audioTransform;
 }
 
-void Plot::Update()
+void Plot::SetSize(int width, int height)
 {
-    float dt = m_window->GetDeltaTime() / 1000.f;
-    float f = m_window->GetDeltaTime() / m_window->GetDeltaTimeTarget();
-
-    float const* spectrum = m_window->GetAudioTransform()->GetSpectrum();
-    size_t spectrumSize = m_window->GetAudioTransform()->GetSpectrumSize();
-
-    std::fill(m_binLevelsDistributed.begin(), m_binLevelsDistributed.end(), 0.f);
-
-    for (size_t i = 0; i < m_spectrumLow; ++i)
-        m_binLevelsDistributed[0] += spectrum[i];
+    m_width = width;
+    m_height = height;
+}
 
-    for (size_t i = m_spectrumLow; i <= m_spectrumHigh; ++i)
-        m_binLevelsDistributed[CalculateSpectrumBin(i)] += spectrum[i];
+void Plot::Update(float deltaTime, float deltaTimeTarget)
+{
+    float dt = deltaTime / 1000.f;
+    float f = deltaTime / deltaTimeTarget;
 
-    for (size_t i = m_spectrumHigh + 1; i < spectrumSize; ++i)
-        m_binLevelsDistributed[GetNumBins() - 1] += spectrum[i];
+    float const* spectrum = m_audioTransform->GetSpectrum();
 
-    for (auto&& bins : m_binsMissed)
+    // everything the distribution decides was worked out with the mapping, what is left is summing each row
+    for (size_t bin = 0; bin < GetNumBins(); ++bin)
     {
-        size_t binFirst = bins[0];
-        size_t binLast = bins[bins.size() - 1];
+        float level = 0.f;
 
-        size_t binLow = binFirst == 0 ? 0 : binFirst - 1;
-        size_t binHigh = binLast == GetNumBins() - 1 ? GetNumBins() - 1 : binLast + 1;
+        for (size_t i = m_rowOffsets[bin]; i < m_rowOffsets[bin + 1]; ++i)
+            level += spectrum[m_columns[i]];
 
-        float binLevelLow = m_binLevelsDistributed[binLow];
-        float binLevelHigh = m_binLevelsDistributed[binHigh];
-
-        float step = 1.f / (bins.size() + 1);
+        m_binLevelsDistributed[bin] = level;
+    }
 
-        for (size_t bin = binFirst; bin <= binLast; ++bin)
-        {
-            float position = step * (bin - binFirst + 1);
+    for (MissedBin const& missedBin : m_missedBins)
+    {
+        float binLevelLow = m_binLevelsDistributed[missedBin.binLow];
+        float binLevelHigh = m_binLevelsDistributed[missedBin.binHigh];
 
-            position = binLevelLow > binLevelHigh ? 1.f - m_frequencyDistribution(1.f - position) : m_frequencyDistribution(position);
+        float position = binLevelLow > binLevelHigh ? missedBin.positionFalling : missedBin.positionRising;
 
-            m_binLevelsDistributed[bin] = Lerp(position, binLevelLow, binLevelHigh);
-        }
+        m_binLevelsDistributed[missedBin.bin] = Lerp(position, binLevelLow, binLevelHigh);
     }
 
     float levelMax = *std::max_element(m_binLevelsDistributed.begin(), m_binLevelsDistributed.end());
 
-    if (levelMax > 1.f)
-    {
-        for (size_t bin = 0; bin < GetNumBins(); ++bin)
-            m_binLevelsDistributed[bin] /= levelMax;
-    }
+    // normalizing is folded into the step instead of taking its own pass
+    m_barKernel(m_binLevels.data(), m_hatLevels.data(), m_hatLevelVelocities.data(), m_binLevelsDistributed.data(), GetNumBins(),
+        levelMax > 1.f ? 1.f / levelMax : 1.f, (1.f - m_binLevelSmoothness) * f, m_hatGravity * dt, dt);
 
-    for (size_t bin = 0; bin < GetNumBins(); ++bin)
-    {
-        SetBinLevel(bin, Lerp((1.f - m_binLevelSmoothness) * f, GetBinLevel(bin), m_binLevelsDistributed[bin]));
-
-        if (GetHatLevel(bin) > GetBinLevel(bin))
-        {
-            m_hatLevelVelocities[bin] -= m_hatGravity * dt;
-
-            float hatLevelNext = GetHatLevel(bin) + m_hatLevelVelocities[bin] * dt;
-            if (hatLevelNext > GetBinLevel(bin))
-            {
-                SetHatLevel(bin, hatLevelNext);
-            }
-            else
-            {
-                m_hatLevelVelocities[bin] = 0.f;
-                SetHatLevel(bin, GetBinLevel(bin));
-            }
-        }
-        else
-        {
-            SetHatLevel(bin, GetBinLevel(bin));
-        }
-    }
+    CalculateBinGeometry();
 }
 
-void Plot::Render()
+void Plot::Render(SDL_Renderer* renderer) const
 {
-    static auto CalculateBinColor = [this](size_t bin, float level)
-    {
-        float position = m_frequencyDistribution((float)bin / (GetNumBins() - 1));
-
-        return std::make_tuple(
-            (Uint8)Lerp(level, std::get<0>(m_color), Lerp(position, std::get<0>(m_binColorLow), std::get<0>(m_binColorHigh))),
-            (Uint8)Lerp(level, std::get<1>(m_color), Lerp(position, std::get<1>(m_binColorLow), std::get<1>(m_binColorHigh))),
-            (Uint8)Lerp(level, std::get<2>(m_color), Lerp(position, std::get<2>(m_binColorLow), std::get<2>(m_binColorHigh))));
-    };
+    SDL_RenderGeometry(renderer, nullptr, m_vertices.data(), (int)m_vertices.size(), m_indices.data(), (int)m_indices.size());
+}
 
+void Plot::CalculateBinGeometry()
+{
     for (size_t bin = 0; bin < GetNumBins(); ++bin)
     {
-        Uint8 r, g, b;
+        SDL_Vertex* binQuad = &m_vertices[bin * 8];
+        SDL_Vertex* hatQuad = binQuad + 4;
 
         float level = GetBinLevel(bin);
 
-        std::tie(r, g, b) = CalculateBinColor(bin, level);
-        SDL_SetRenderDrawColor(m_window->GetRenderer(), r, g, b, 255);
-
-        SDL_RenderFillRectF(m_window->GetRenderer(), &m_bins[bin]);
-
-        std::tie(r, g, b) = m_color;
-        SDL_SetRenderDrawColor(m_window->GetRenderer(), r, g, b, 255);
+        SetQuadVertical(binQuad, m_binSpacing + (m_hatHeight + m_hatBinSpacing) + m_binHeightMax * (1.f - level), m_binHeightMax * level);
+        size_t levelIndex = (size_t)std::round((std::min)((std::max)(level, 0.f), 1.f) * (BIN_COLOR_NUM_LEVELS - 1));
+        SetQuadColor(binQuad, m_binColors[bin * BIN_COLOR_NUM_LEVELS + levelIndex]);
 
-        SDL_RenderFillRectF(m_window->GetRenderer(), &m_hats[bin]);
+        SetQuadVertical(hatQuad, m_binSpacing + m_binHeightMax * (1.f - GetHatLevel(bin)), m_hatHeight);
     }
 }
 
@@ -178,8 +162,11 @@ void Plot::CalculateBinValues()
     std::vector<float> binLevelsDistributedOld(m_binLevelsDistributed);
     std::vector<float> hatLevelVelocitiesOld(m_hatLevelVelocities);
 
-    m_bins.resize(m_window->GetWidth() / 16);
-    m_hats.resize(GetNumBins());
+    m_binLevels.resize(m_width / 16);
+    m_hatLevels.resize(GetNumBins());
+
+    m_vertices.assign(GetNumBins() * 8, SDL_Vertex());
+    m_indices.resize(GetNumBins() * 12);
 
     m_binLevelsDistributed.resize(GetNumBins(), 0.f);
     m_hatLevelVelocities.resize(GetNumBins(), 0.f);
@@ -191,7 +178,7 @@ void Plot::CalculateBinValues()
 
         for (size_t bin = 0; bin < GetNumBins(); ++bin)
         {
-            size_t binOld = (size_t)std::roundf((float)bin / (GetNumBins() - 1) * (numBinsOld - 1));
+            size_t binOld = (size_t)std::round((float)bin / (GetNumBins() - 1) * (numBinsOld - 1));
 
             m_binLevelsDistributed[bin] += binLevelsDistributedOld[binOld];
             m_hatLevelVelocities[bin] = hatLevelVelocitiesOld[binOld];
@@ -206,51 +193,194 @@ void Plot::CalculateBinValues()
         }
     }
 
-    m_binWidth = (m_window->GetWidth() - (GetNumBins() + 1) * m_binSpacing) / GetNumBins();
-    m_binHeightMax = m_window->GetHeight() - 2.f * m_binSpacing - (m_hatHeight + m_hatBinSpacing);
+    m_binWidth = (m_width - (GetNumBins() + 1) * m_binSpacing) / GetNumBins();
+    m_binHeightMax = m_height - 2.f * m_binSpacing - (m_hatHeight + m_hatBinSpacing);
 
     for (size_t bin = 0; bin < GetNumBins(); ++bin)
     {
-        m_bins[bin].x = m_binSpacing + (m_binWidth + m_binSpacing) * bin;
-        m_bins[bin].w = m_binWidth;
+        SDL_Vertex* binQuad = &m_vertices[bin * 8];
+        SDL_Vertex* hatQuad = binQuad + 4;
+
+        SetQuadHorizontal(binQuad, m_binSpacing + (m_binWidth + m_binSpacing) * bin, m_binWidth);
+        SetQuadHorizontal(hatQuad, binQuad[0].position.x, m_binWidth);
+        SetQuadColor(hatQuad, { std::get<0>(m_color), std::get<1>(m_color), std::get<2>(m_color), 255 });
 
-        m_hats[bin].x = m_bins[bin].x;
-        m_hats[bin].w = m_bins[bin].w;
-        m_hats[bin].h = m_hatHeight;
+        // two triangles for each quad
+        for (int quad = 0; quad < 2; ++quad)
+        {
+            int* indices = &m_indices[bin * 12 + quad * 6];
+            int first = (int)(bin * 8 + quad * 4);
+
+            indices[0] = first;
+            indices[1] = first + 1;
+            indices[2] = first + 2;
+            indices[3] = first;
+            indices[4] = first + 2;
+            indices[5] = first + 3;
+        }
 
-        SetBinLevel(bin, m_binLevelsDistributed[bin]);
-        SetHatLevel(bin, GetBinLevel(bin));
+        m_binLevels[bin] = m_binLevelsDistributed[bin];
+        m_hatLevels[bin] = m_binLevels[bin];
+    }
+
+    CalculateBinColors();
+    CalculateBinGeometry();
+}
+
+void Plot::SetBinColorStops(std::vector<ColorStop> stops)
+{
+    m_binColorStops = std::move(stops);
+
+    CalculateBinColors();
+    CalculateBinGeometry();
+}
+
+void Plot::CalculateBinColors()
+{
+    m_binColors.resize(GetNumBins() * BIN_COLOR_NUM_LEVELS);
+
+    std::vector<float> positions(GetNumBins());
+    GetFrequencyDistributionKernels(m_frequencyDistribution).distributeBins(GetNumBins(), positions.data());
+
+    for (size_t bin = 0; bin < GetNumBins(); ++bin)
+    {
+        float position = positions[bin];
+
+        // the stops the bin falls between, the outermost ones holding their colors past the ends
+        size_t stopHigh = 0;
+        while (stopHigh + 1 < m_binColorStops.size() && m_binColorStops[stopHigh].position < position)
+            ++stopHigh;
+
+        size_t stopLow = stopHigh > 0 ? stopHigh - 1 : 0;
+
+        ColorStop const& low = m_binColorStops[stopLow];
+        ColorStop const& high = m_binColorStops[stopHigh];
+
+        float stopPosition = high.position > low.position ? (std::min)((std::max)((position - low.position) / (high.position - low.position), 0.f), 1.f) : 1.f;
+
+        float r = Lerp(stopPosition, std::get<0>(low.color), std::get<0>(high.color));
+        float g = Lerp(stopPosition, std::get<1>(low.color), std::get<1>(high.color));
+        float b = Lerp(stopPosition, std::get<2>(low.color), std::get<2>(high.color));
+
+        // quiet bins fade into the plot color
+        for (size_t levelIndex = 0; levelIndex < BIN_COLOR_NUM_LEVELS; ++levelIndex)
+        {
+            float level = (float)levelIndex / (BIN_COLOR_NUM_LEVELS - 1);
+
+            m_binColors[bin * BIN_COLOR_NUM_LEVELS + levelIndex] = {
+                (Uint8)Lerp(level, std::get<0>(m_color), r),
+                (Uint8)Lerp(level, std::get<1>(m_color), g),
+                (Uint8)Lerp(level, std::get<2>(m_color), b),
+                255 };
+        }
     }
 }
 
 void Plot::CalculateSpectrumValues()
 {
-    size_t numFrequencies = m_window->GetAudioCapture()->GetSampleRate() / 2;
-    size_t spectrumSize = m_window->GetAudioTransform()->GetSpectrumSize();
+    // a filterbank's spectrum is laid out by the bins, so it has to follow them before it can be mapped
+    m_audioTransform->SetFilterFrequencies(CalculateBinFrequencies(GetNumBins()));
+
+    SetSpectrumMapping(CalculateSpectrumMapping(m_audioTransform, GetNumBins(), m_frequencyDistribution));
+}
+
+std::vector<float> Plot::CalculateBinFrequencies(size_t numBins) const
+{
+    std::vector<float> frequencies(numBins);
+
+    GetFrequencyDistributionKernels(m_frequencyDistribution).invertBins(numBins, frequencies.data());
+
+    for (size_t bin = 0; bin < numBins; ++bin)
+        frequencies[bin] = Lerp(frequencies[bin], (float)m_frequencyLow, (float)m_frequencyHigh);
+
+    return frequencies;
+}
+
+Plot::SpectrumMapping Plot::CalculateSpectrumMapping(AudioTransform const* transform, size_t numBins, FrequencyDistribution distribution) const
+{
+    SpectrumMapping mapping;
+
+    FrequencyDistributionKernels const& kernels = GetFrequencyDistributionKernels(distribution);
+
+    size_t spectrumSize = transform->GetSpectrumSize();
 
-    m_spectrumLow = numFrequencies > m_frequencyLow ? m_frequencyLow : 0;
-    m_spectrumHigh = (std::min)(m_frequencyHigh, numFrequencies);
+    mapping.numBins = numBins;
+    mapping.distribution = distribution;
 
-    m_spectrumLow = (size_t)std::floorf((float)m_spectrumLow / numFrequencies * spectrumSize);
-    m_spectrumHigh = (size_t)std::ceilf((float)m_spectrumHigh / numFrequencies * spectrumSize);
+    // the last entry at or below the low frequency and the first at or above the high one; entries are
+    // placed by frequency, so linear and logarithmically spaced spectra end up on the same bins
+    size_t spectrumLow = 0;
+    while (spectrumLow + 1 < spectrumSize && transform->GetSpectrumFrequency(spectrumLow + 1) <= m_frequencyLow)
+        ++spectrumLow;
 
-    m_binsMissed.clear();
+    size_t spectrumHigh = spectrumLow;
+    while (spectrumHigh + 1 < spectrumSize && transform->GetSpectrumFrequency(spectrumHigh) < m_frequencyHigh)
+        ++spectrumHigh;
+
+    float frequencyLow = transform->GetSpectrumFrequency(spectrumLow);
+    float frequencyHigh = transform->GetSpectrumFrequency(spectrumHigh);
+
+    // bin of every entry, those outside the range piling up on the outermost bins
+    std::vector<size_t> spectrumBins(spectrumSize);
+
+    std::vector<float> positions(spectrumHigh - spectrumLow + 1);
+    for (size_t i = spectrumLow; i <= spectrumHigh; ++i)
+        positions[i - spectrumLow] = transform->GetSpectrumFrequency(i);
+
+    kernels.distributeFrequencies(positions.data(), positions.size(), frequencyLow, frequencyHigh, positions.data());
+
+    for (size_t i = 0; i < spectrumSize; ++i)
+    {
+        if (i < spectrumLow)
+            spectrumBins[i] = 0;
+        else if (i > spectrumHigh)
+            spectrumBins[i] = numBins - 1;
+        else
+            spectrumBins[i] = (size_t)std::round((numBins - 1) * positions[i - spectrumLow]);
+    }
+
+    // entries rise with their bins, so the rows fill in order
+    mapping.rowOffsets.assign(numBins + 1, 0);
+    for (size_t bin : spectrumBins)
+        ++mapping.rowOffsets[bin + 1];
+
+    std::partial_sum(mapping.rowOffsets.begin(), mapping.rowOffsets.end(), mapping.rowOffsets.begin());
+
+    mapping.columns.resize(spectrumSize);
+
+    std::vector<size_t> rowEnds(mapping.rowOffsets.begin(), mapping.rowOffsets.end() - 1);
+    for (size_t i = 0; i < spectrumSize; ++i)
+        mapping.columns[rowEnds[spectrumBins[i]]++] = (uint32_t)i;
 
     size_t binPrev = 0;
 
-    for (size_t i = m_spectrumLow; i <= m_spectrumHigh; ++i)
+    for (size_t i = spectrumLow; i <= spectrumHigh; ++i)
     {
-        size_t bin = CalculateSpectrumBin(i);
+        size_t bin = spectrumBins[i];
 
+        // the bins in between take levels from the two entries' bins
         if (bin - binPrev > 1)
         {
-            std::vector<size_t> bins(bin - binPrev - 1);
+            float step = 1.f / (bin - binPrev);
 
-            std::iota(bins.begin(), bins.end(), binPrev + 1);
+            for (size_t missed = binPrev + 1; missed < bin; ++missed)
+            {
+                float position = step * (missed - binPrev);
 
-            m_binsMissed.push_back(std::move(bins));
+                mapping.missedBins.push_back({ missed, binPrev, bin,
+                    kernels.distribute(position), 1.f - kernels.distribute(1.f - position) });
+            }
         }
 
         binPrev = bin;
     }
+
+    return mapping;
+}
+
+void Plot::SetSpectrumMapping(SpectrumMapping&& mapping)
+{
+    m_rowOffsets = std::move(mapping.rowOffsets);
+    m_columns = std::move(mapping.columns);
+    m_missedBins = std::move(mapping.missedBins);
 }
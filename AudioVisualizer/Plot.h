@@ -1,19 +1,52 @@
 #pragma once
 
+#include "BarKernels.h"
+#include "FrequencyDistribution.h"
+
 #include <SDL.h>
 
 #include <stddef.h>
+#include <stdint.h>
 
-#include <functional>
 #include <tuple>
 #include <vector>
 
-class Window;
+class AudioTransform;
 
 class Plot
 {
 public:
-    Plot(Window* window);
+    // a bin no spectrum entry falls into, which takes a level between those of its neighbours
+    struct MissedBin
+    {
+        size_t bin;
+        size_t binLow;
+        size_t binHigh;
+        // where between the neighbours it sits when the levels rise towards binHigh and when they fall
+        float positionRising;
+        float positionFalling;
+    };
+
+    // which spectrum entries feed which bins, depends only on the bin count, the distribution and the transform's
+    // spectrum layout
+    struct SpectrumMapping
+    {
+        size_t numBins;
+        FrequencyDistribution distribution;
+        // compressed sparse rows, one per bin, of the spectrum entries summed into it
+        std::vector<size_t> rowOffsets;
+        std::vector<uint32_t> columns;
+        std::vector<MissedBin> missedBins;
+    };
+
+    // a color of the bin gradient and where along the bins, from 0 to 1 as spread by the distribution, it sits
+    struct ColorStop
+    {
+        float position;
+        std::tuple<Uint8, Uint8, Uint8> color;
+    };
+
+    Plot(AudioTransform* audioTransform, int width, int height);
 
     Plot(Plot const&) = delete;
     Plot(Plot&&) = delete;
@@ -25,44 +58,73 @@ public:
     float GetBinLevel(size_t bin) const;
     float GetHatLevel(size_t bin) const;
 
-    void Update();
-    void Render();
+    FrequencyDistribution GetFrequencyDistribution() const;
+    // the spectrum values have to be recalculated afterwards
+    void SetFrequencyDistribution(FrequencyDistribution distribution);
+    // the spectrum values have to be recalculated afterwards, or a mapping calculated for the transform set
+    void SetAudioTransform(AudioTransform* audioTransform);
+    // the bin and spectrum values have to be recalculated afterwards
+    void SetSize(int width, int height);
+
+    // steps the bars towards the transform's spectrum and lays out what Render() draws; times in milliseconds
+    void Update(float deltaTime, float deltaTimeTarget);
+    void Render(SDL_Renderer* renderer) const;
 
     void CalculateBinValues();
     void CalculateSpectrumValues();
 
-private:
-    void SetBinLevel(size_t bin, float level);
-    void SetHatLevel(size_t bin, float level);
+    // at least one stop, sorted by position; the colors of loud bins blend between them
+    void SetBinColorStops(std::vector<ColorStop> stops);
+
+    // frequency each of numBins bins is centered on, for transforms that analyze bins directly
+    std::vector<float> CalculateBinFrequencies(size_t numBins) const;
 
-    size_t CalculateSpectrumBin(size_t spectrum);
+    // safe to call from any thread, the result is applied with SetSpectrumMapping() on the render thread
+    SpectrumMapping CalculateSpectrumMapping(AudioTransform const* transform, size_t numBins, FrequencyDistribution distribution) const;
+    void SetSpectrumMapping(SpectrumMapping&& mapping);
 
-    Window* m_window;
+private:
+    void CalculateBinColors();
+    // the heights and bin colors of the geometry, from the current levels
+    void CalculateBinGeometry();
+
+    AudioTransform* m_audioTransform;
+    int m_width;
+    int m_height;
 
     std::tuple<Uint8, Uint8, Uint8> m_color;
 
     float m_binSpacing;
     float m_binWidth;
     float m_binHeightMax;
-    std::tuple<Uint8, Uint8, Uint8> m_binColorLow;
-    std::tuple<Uint8, Uint8, Uint8> m_binColorHigh;
-    std::vector<SDL_FRect> m_bins;
+    std::vector<ColorStop> m_binColorStops;
+    // color of every bin at every quantized level, a row of levels per bin
+    std::vector<SDL_Color> m_binColors;
 
     float m_hatHeight;
     float m_hatBinSpacing;
-    std::vector<SDL_FRect> m_hats;
+
+    // a quad for each bin followed by one for its hat, drawn in a single batch; the indices and everything but
+    // the heights and bin colors are set when the bins change, the rest is rewritten in place on every update
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int> m_indices;
 
     size_t m_frequencyLow;
     size_t m_frequencyHigh;
-    std::function<float(float)> m_frequencyDistribution;
+    FrequencyDistribution m_frequencyDistribution;
 
-    size_t m_spectrumLow;
-    size_t m_spectrumHigh;
-    std::vector<std::vector<size_t>> m_binsMissed;
+    std::vector<size_t> m_rowOffsets;
+    std::vector<uint32_t> m_columns;
+    std::vector<MissedBin> m_missedBins;
     std::vector<float> m_binLevelsDistributed;
 
+    // simulation state, one entry per bin, stepped together by m_barKernel
+    std::vector<float> m_binLevels;
+    std::vector<float> m_hatLevels;
     std::vector<float> m_hatLevelVelocities;
 
     float m_binLevelSmoothness;
     float m_hatGravity;
+
+    BarKernel m_barKernel;
 };
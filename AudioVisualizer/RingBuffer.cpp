@@ -0,0 +1,306 @@
+#include "RingBuffer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+static size_t GetAllocationGranularity()
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwAllocationGranularity;
+#elif defined(__linux__)
+    return (size_t)sysconf(_SC_PAGESIZE);
+#else
+    return 1;
+#endif
+}
+
+static float* MapMirrored(size_t numBytes)
+{
+    float* data = nullptr;
+
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        (DWORD)((uint64_t)numBytes >> 32), (DWORD)numBytes, nullptr);
+
+    if (mapping)
+    {
+        // another thread may grab the reserved range between VirtualFree and MapViewOfFileEx, so retry a few times
+        for (int attempt = 0; attempt < 16 && !data; ++attempt)
+        {
+            uint8_t* base = (uint8_t*)VirtualAlloc(nullptr, numBytes * 2, MEM_RESERVE, PAGE_NOACCESS);
+            if (!base)
+                break;
+            VirtualFree(base, 0, MEM_RELEASE);
+
+            void* first = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, numBytes, base);
+            void* second = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, numBytes, base + numBytes);
+
+            if (first == base && second == base + numBytes)
+            {
+                data = (float*)base;
+            }
+            else
+            {
+                if (first)
+                    UnmapViewOfFile(first);
+                if (second)
+                    UnmapViewOfFile(second);
+            }
+        }
+
+        // the views keep the section alive
+        CloseHandle(mapping);
+    }
+#elif defined(__linux__)
+    int fd = memfd_create("RingBuffer", MFD_CLOEXEC);
+
+    if (fd >= 0)
+    {
+        if (ftruncate(fd, (off_t)numBytes) == 0)
+        {
+            uint8_t* base = (uint8_t*)mmap(nullptr, numBytes * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (base != MAP_FAILED)
+            {
+                if (mmap(base, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+                    mmap(base + numBytes, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED)
+                    data = (float*)base;
+                else
+                    munmap(base, numBytes * 2);
+            }
+        }
+
+        // the mappings keep the memory alive
+        close(fd);
+    }
+#endif
+
+    return data;
+}
+
+static void UnmapMirrored(float* data, size_t numBytes)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    UnmapViewOfFile((uint8_t*)data + numBytes);
+#elif defined(__linux__)
+    munmap(data, numBytes * 2);
+#endif
+}
+
+RingBuffer::RingBuffer()
+    : m_data()
+    , m_size()
+    , m_mask()
+    , m_isMirrored(false)
+    , m_silenceIndex(SIZE_MAX)
+    , m_writeIndex(0)
+    , m_readIndex(0)
+{
+}
+
+RingBuffer::~RingBuffer()
+{
+    Unmap();
+}
+
+bool RingBuffer::Reset(size_t capacity, size_t numChannels)
+{
+    size_t granularity = GetAllocationGranularity();
+
+    // both halves must start on an allocation boundary for the second mapping to line up
+    size_t size = 1;
+    while (size < capacity || size * sizeof(float) < granularity)
+        size <<= 1;
+
+    Unmap();
+
+    if (!Map(size, numChannels))
+        return false;
+
+    m_mask = size - 1;
+
+    m_silenceIndex.store(SIZE_MAX, std::memory_order_relaxed);
+    m_writeIndex.store(0, std::memory_order_relaxed);
+    m_readIndex.store(0, std::memory_order_relaxed);
+
+    return true;
+}
+
+bool RingBuffer::Map(size_t size, size_t numChannels)
+{
+    m_size = size;
+    m_isMirrored = true;
+
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        float* data = MapMirrored(size * sizeof(float));
+        if (!data)
+        {
+            // every channel has to be written the same way
+            Unmap();
+            break;
+        }
+        m_data.push_back(data);
+    }
+
+    if (!m_isMirrored)
+    {
+        m_size = size;
+
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            float* data = new (std::nothrow) float[size * 2]();
+            if (!data)
+            {
+                Unmap();
+                return false;
+            }
+            m_data.push_back(data);
+        }
+    }
+
+    return true;
+}
+
+void RingBuffer::Unmap()
+{
+    for (float* data : m_data)
+    {
+        if (m_isMirrored)
+            UnmapMirrored(data, m_size * sizeof(float));
+        else
+            delete[] data;
+    }
+
+    m_data.clear();
+    m_size = 0;
+    m_isMirrored = false;
+}
+
+size_t RingBuffer::GetCapacity() const
+{
+    return m_size;
+}
+
+size_t RingBuffer::GetNumChannels() const
+{
+    return m_data.size();
+}
+
+size_t RingBuffer::GetNumAvailable() const
+{
+    return m_writeIndex.load(std::memory_order_acquire) - m_readIndex.load(std::memory_order_relaxed);
+}
+
+size_t RingBuffer::WriteZeros(size_t numSamples)
+{
+    numSamples = BeginWrite(numSamples);
+
+    for (size_t channel = 0; channel < m_data.size(); ++channel)
+        std::fill_n(GetWriteData(channel), numSamples, 0.f);
+
+    // extend the current run or start a new one, published together with the samples by Commit()
+    if (m_silenceIndex.load(std::memory_order_relaxed) == SIZE_MAX)
+        m_silenceIndex.store(m_writeIndex.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    Commit(numSamples);
+    return numSamples;
+}
+
+size_t RingBuffer::BeginWrite(size_t numSamples)
+{
+    size_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+    size_t readIndex = m_readIndex.load(std::memory_order_acquire);
+
+    // drop what does not fit, the consumer only ever looks at the latest window anyway
+    return (std::min)(numSamples, GetCapacity() - (writeIndex - readIndex));
+}
+
+float* RingBuffer::GetWriteData(size_t channel) const
+{
+    return m_data[channel] + (m_writeIndex.load(std::memory_order_relaxed) & m_mask);
+}
+
+void RingBuffer::EndWrite(size_t numSamples)
+{
+    if (numSamples > 0)
+        m_silenceIndex.store(SIZE_MAX, std::memory_order_relaxed);
+
+    Commit(numSamples);
+}
+
+void RingBuffer::Commit(size_t numSamples)
+{
+    size_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+
+    if (!m_isMirrored)
+    {
+        size_t offset = writeIndex & m_mask;
+        size_t numSamplesFirst = (std::min)(numSamples, m_size - offset);
+
+        for (float* data : m_data)
+        {
+            std::copy(data + offset, data + offset + numSamplesFirst, data + offset + m_size);
+            if (numSamples > numSamplesFirst)
+                std::copy(data + m_size, data + offset + numSamples, data);
+        }
+    }
+
+    m_writeIndex.store(writeIndex + numSamples, std::memory_order_release);
+}
+
+size_t RingBuffer::Skip(size_t numSamples)
+{
+    size_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+    size_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+
+    numSamples = (std::min)(numSamples, writeIndex - readIndex);
+
+    m_readIndex.store(readIndex + numSamples, std::memory_order_release);
+    return numSamples;
+}
+
+size_t RingBuffer::SkipTo(size_t index)
+{
+    size_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+
+    // indices wrap, so compare by distance
+    if ((ptrdiff_t)(index - readIndex) <= 0)
+        return 0;
+
+    return Skip(index - readIndex);
+}
+
+size_t RingBuffer::GetWriteIndex() const
+{
+    return m_writeIndex.load(std::memory_order_acquire);
+}
+
+float const* RingBuffer::GetData(size_t channel, size_t index) const
+{
+    return m_data[channel] + (index & m_mask);
+}
+
+size_t RingBuffer::GetNumSilent(size_t writeIndex) const
+{
+    // a run may have ended or a new one started since writeIndex was read, so only trust a run that began before it
+    size_t silenceIndex = m_silenceIndex.load(std::memory_order_relaxed);
+    if (silenceIndex == SIZE_MAX)
+        return 0;
+
+    return (ptrdiff_t)(writeIndex - silenceIndex) >= 0 ? writeIndex - silenceIndex : 0;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+#include <vector>
+
+// Lock-free single-producer/single-consumer queue of planar multichannel
+// samples. All channels share one pair of indices, so a frame is either
+// visible in every channel or in none. WriteZeros(), BeginWrite(),
+// GetWriteData() and EndWrite() may only be called from the producer thread,
+// Skip(), SkipTo(), GetWriteIndex() and GetData() only from the consumer
+// thread. Reset() requires both to be idle.
+//
+// Each channel is mapped twice back to back in virtual memory, so any run of
+// up to GetCapacity() samples is contiguous no matter where it wraps. Where
+// that is not possible the second half is kept in sync by writing twice.
+//
+// Runs of WriteZeros() are tracked, so the consumer can tell that a window is
+// silent without reading it.
+class RingBuffer
+{
+public:
+    RingBuffer();
+
+    RingBuffer(RingBuffer const&) = delete;
+    RingBuffer(RingBuffer&&) = delete;
+
+    RingBuffer& operator=(RingBuffer const&) = delete;
+    RingBuffer& operator=(RingBuffer&&) = delete;
+
+    ~RingBuffer();
+
+    bool Reset(size_t capacity, size_t numChannels);
+
+    size_t GetCapacity() const;
+    size_t GetNumChannels() const;
+    size_t GetNumAvailable() const;
+
+    size_t WriteZeros(size_t numSamples);
+
+    // reserves contiguous space for up to numSamples samples per channel and returns how many fit,
+    // filled through GetWriteData() and committed by EndWrite()
+    size_t BeginWrite(size_t numSamples);
+    float* GetWriteData(size_t channel) const;
+    void EndWrite(size_t numSamples);
+
+    size_t Skip(size_t numSamples);
+    // drops everything before an absolute index, never moving backwards or past the write end
+    size_t SkipTo(size_t index);
+
+    // absolute index one past the newest sample
+    size_t GetWriteIndex() const;
+
+    // contiguous view starting at an absolute index, samples never written read as zeros
+    float const* GetData(size_t channel, size_t index) const;
+
+    // how many samples right before writeIndex (a value from GetWriteIndex()) are known to be zeros
+    // written by WriteZeros(), without looking at them
+    size_t GetNumSilent(size_t writeIndex) const;
+
+private:
+    bool Map(size_t size, size_t numChannels);
+    void Unmap();
+
+    void Commit(size_t numSamples);
+
+    std::vector<float*> m_data;
+    size_t m_size;
+    size_t m_mask;
+    bool m_isMirrored;
+
+    // the producer's and the consumer's indices are a cache line apart from each other and from the rest;
+    // padded rather than aligned, as alignas(64) would over-align every class embedding the ring
+    char m_producerPadding[64];
+
+    // start of the run of zeros at the write end, SIZE_MAX while the newest samples are not silent
+    std::atomic<size_t> m_silenceIndex;
+    std::atomic<size_t> m_writeIndex;
+
+    char m_consumerPadding[64];
+
+    std::atomic<size_t> m_readIndex;
+
+    char m_padding[64];
+};
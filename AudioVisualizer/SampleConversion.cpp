@@ -0,0 +1,469 @@
+#include "SampleConversion.h"
+
+#include <SDL.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SAMPLE_CONVERSION_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+bool ParseSampleFormat(std::string const& name, SampleFormat& sampleFormat)
+{
+    if (name == "s16")
+        sampleFormat = SampleFormat::Int16;
+    else if (name == "s24")
+        sampleFormat = SampleFormat::Int24;
+    else if (name == "s32")
+        sampleFormat = SampleFormat::Int32;
+    else if (name == "f32")
+        sampleFormat = SampleFormat::Float32;
+    else if (name == "f64")
+        sampleFormat = SampleFormat::Float64;
+    else
+        return false;
+
+    return true;
+}
+
+size_t GetSampleFormatSize(SampleFormat sampleFormat)
+{
+    switch (sampleFormat)
+    {
+    case SampleFormat::Int16:
+        return 2;
+    case SampleFormat::Int24:
+        return 3;
+    case SampleFormat::Int32:
+        return 4;
+    case SampleFormat::Float32:
+        return 4;
+    case SampleFormat::Float64:
+        return 8;
+    }
+    return 0;
+}
+
+static void ConvertInt16Scalar(void const* input, size_t numSamples, float* output)
+{
+    int16_t const* samples = static_cast<int16_t const*>(input);
+
+    for (size_t i = 0; i < numSamples; ++i)
+        output[i] = samples[i] * (1.f / 32768.f);
+}
+
+static void ConvertInt24Scalar(void const* input, size_t numSamples, float* output)
+{
+    uint8_t const* bytes = static_cast<uint8_t const*>(input);
+
+    // assemble in the top three bytes so the sign lands in place
+    for (size_t i = 0; i < numSamples; ++i, bytes += 3)
+        output[i] = (int32_t)((uint32_t)bytes[0] << 8 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 24) * (1.f / 2147483648.f);
+}
+
+static void ConvertInt32Scalar(void const* input, size_t numSamples, float* output)
+{
+    int32_t const* samples = static_cast<int32_t const*>(input);
+
+    for (size_t i = 0; i < numSamples; ++i)
+        output[i] = samples[i] * (1.f / 2147483648.f);
+}
+
+static void ConvertFloat32(void const* input, size_t numSamples, float* output)
+{
+    float const* samples = static_cast<float const*>(input);
+
+    for (size_t i = 0; i < numSamples; ++i)
+        output[i] = samples[i];
+}
+
+static void ConvertFloat64Scalar(void const* input, size_t numSamples, float* output)
+{
+    double const* samples = static_cast<double const*>(input);
+
+    for (size_t i = 0; i < numSamples; ++i)
+        output[i] = (float)samples[i];
+}
+
+#ifdef SAMPLE_CONVERSION_X86
+
+static void ConvertInt16SSE2(void const* input, size_t numSamples, float* output)
+{
+    int16_t const* samples = static_cast<int16_t const*>(input);
+    __m128 const scale = _mm_set1_ps(1.f / 32768.f);
+    size_t i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((__m128i const*)(samples + i));
+
+        // widen by unpacking into the high halves and shifting back down with sign extension
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+
+    ConvertInt16Scalar(samples + i, numSamples - i, output + i);
+}
+
+TARGET_AVX2 static void ConvertInt16AVX2(void const* input, size_t numSamples, float* output)
+{
+    int16_t const* samples = static_cast<int16_t const*>(input);
+    __m256 const scale = _mm256_set1_ps(1.f / 32768.f);
+    size_t i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i const*)(samples + i)));
+
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+
+    ConvertInt16Scalar(samples + i, numSamples - i, output + i);
+}
+
+TARGET_AVX2 static void ConvertInt24AVX2(void const* input, size_t numSamples, float* output)
+{
+    uint8_t const* bytes = static_cast<uint8_t const*>(input);
+    __m256 const scale = _mm256_set1_ps(1.f / 2147483648.f);
+
+    // bytes 0-15 go to the low lane and bytes 12-27 to the high lane, then every
+    // sample is shuffled into the top three bytes of its own dword
+    __m256i const permutation = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    __m256i const shuffle = _mm256_setr_epi8(
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+
+    size_t i = 0;
+
+    // each load reads 32 bytes for 8 samples (24 bytes), so stop early enough not to read past the end
+    for (; i + 11 <= numSamples; i += 8, bytes += 24)
+    {
+        __m256i v = _mm256_loadu_si256((__m256i const*)bytes);
+        v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, permutation), shuffle);
+
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+
+    ConvertInt24Scalar(bytes, numSamples - i, output + i);
+}
+
+static void ConvertInt32SSE2(void const* input, size_t numSamples, float* output)
+{
+    int32_t const* samples = static_cast<int32_t const*>(input);
+    __m128 const scale = _mm_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((__m128i const*)(samples + i))), scale));
+
+    ConvertInt32Scalar(samples + i, numSamples - i, output + i);
+}
+
+TARGET_AVX2 static void ConvertInt32AVX2(void const* input, size_t numSamples, float* output)
+{
+    int32_t const* samples = static_cast<int32_t const*>(input);
+    __m256 const scale = _mm256_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i const*)(samples + i))), scale));
+
+    ConvertInt32Scalar(samples + i, numSamples - i, output + i);
+}
+
+static void ConvertFloat64SSE2(void const* input, size_t numSamples, float* output)
+{
+    double const* samples = static_cast<double const*>(input);
+    size_t i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(samples + i));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(samples + i + 2));
+
+        _mm_storeu_ps(output + i, _mm_movelh_ps(lo, hi));
+    }
+
+    ConvertFloat64Scalar(samples + i, numSamples - i, output + i);
+}
+
+TARGET_AVX2 static void ConvertFloat64AVX2(void const* input, size_t numSamples, float* output)
+{
+    double const* samples = static_cast<double const*>(input);
+    size_t i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(samples + i));
+        __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(samples + i + 4));
+
+        _mm256_storeu_ps(output + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+
+    ConvertFloat64Scalar(samples + i, numSamples - i, output + i);
+}
+
+#endif
+
+static void DeinterleaveRange(float const* input, size_t numChannels, size_t firstFrame, size_t numFrames, float* const* outputs)
+{
+    for (size_t i = firstFrame; i < numFrames; ++i)
+        for (size_t j = 0; j < numChannels; ++j)
+            outputs[j][i] = input[i * numChannels + j];
+}
+
+static void DeinterleaveScalar(float const* input, size_t numChannels, size_t numFrames, float* const* outputs)
+{
+    DeinterleaveRange(input, numChannels, 0, numFrames, outputs);
+}
+
+static void DeinterleaveMono(float const* input, size_t /*numChannels*/, size_t numFrames, float* const* outputs)
+{
+    for (size_t i = 0; i < numFrames; ++i)
+        outputs[0][i] = input[i];
+}
+
+#ifdef SAMPLE_CONVERSION_X86
+
+// two runs of four samples, one per 128-bit lane, so the per-lane shuffles below work unchanged
+TARGET_AVX2 static inline __m256 LoadLanes(float const* lo, float const* hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+}
+
+// _MM_TRANSPOSE4_PS within each 128-bit lane
+TARGET_AVX2 static inline void Transpose4(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+{
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t2 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+
+    r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// the last two channels of two 5.1 frames, [a4, a5, b4, b5]
+static inline __m128 LoadPairs(float const* a, float const* b)
+{
+    return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((double const*)a)), _mm_castpd_ps(_mm_load_sd((double const*)b)));
+}
+
+static void Deinterleave2SSE2(float const* input, size_t /*numChannels*/, size_t numFrames, float* const* outputs)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        __m128 a = _mm_loadu_ps(input + i * 2);
+        __m128 b = _mm_loadu_ps(input + i * 2 + 4);
+
+        _mm_storeu_ps(outputs[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(outputs[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    DeinterleaveRange(input, 2, i, numFrames, outputs);
+}
+
+TARGET_AVX2 static void Deinterleave2AVX2(float const* input, size_t /*numChannels*/, size_t numFrames, float* const* outputs)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        float const* frames = input + i * 2;
+        __m256 a = LoadLanes(frames, frames + 8);
+        __m256 b = LoadLanes(frames + 4, frames + 12);
+
+        _mm256_storeu_ps(outputs[0] + i, _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm256_storeu_ps(outputs[1] + i, _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    DeinterleaveRange(input, 2, i, numFrames, outputs);
+}
+
+// Four 5.1 frames: the first four channels transpose as a 4x4 block, the last
+// two are gathered in pairs and split like stereo.
+static void Deinterleave6SSE2(float const* input, size_t /*numChannels*/, size_t numFrames, float* const* outputs)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        float const* frames = input + i * 6;
+        __m128 c0 = _mm_loadu_ps(frames);
+        __m128 c1 = _mm_loadu_ps(frames + 6);
+        __m128 c2 = _mm_loadu_ps(frames + 12);
+        __m128 c3 = _mm_loadu_ps(frames + 18);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+        __m128 p = LoadPairs(frames + 4, frames + 10);
+        __m128 q = LoadPairs(frames + 16, frames + 22);
+
+        _mm_storeu_ps(outputs[0] + i, c0);
+        _mm_storeu_ps(outputs[1] + i, c1);
+        _mm_storeu_ps(outputs[2] + i, c2);
+        _mm_storeu_ps(outputs[3] + i, c3);
+        _mm_storeu_ps(outputs[4] + i, _mm_shuffle_ps(p, q, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(outputs[5] + i, _mm_shuffle_ps(p, q, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    DeinterleaveRange(input, 6, i, numFrames, outputs);
+}
+
+TARGET_AVX2 static void Deinterleave6AVX2(float const* input, size_t /*numChannels*/, size_t numFrames, float* const* outputs)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        float const* frames = input + i * 6;
+        __m256 c0 = LoadLanes(frames, frames + 24);
+        __m256 c1 = LoadLanes(frames + 6, frames + 30);
+        __m256 c2 = LoadLanes(frames + 12, frames + 36);
+        __m256 c3 = LoadLanes(frames + 18, frames + 42);
+        Transpose4(c0, c1, c2, c3);
+
+        __m256 p = _mm256_insertf128_ps(_mm256_castps128_ps256(LoadPairs(frames + 4, frames + 10)), LoadPairs(frames + 28, frames + 34), 1);
+        __m256 q = _mm256_insertf128_ps(_mm256_castps128_ps256(LoadPairs(frames + 16, frames + 22)), LoadPairs(frames + 40, frames + 46), 1);
+
+        _mm256_storeu_ps(outputs[0] + i, c0);
+        _mm256_storeu_ps(outputs[1] + i, c1);
+        _mm256_storeu_ps(outputs[2] + i, c2);
+        _mm256_storeu_ps(outputs[3] + i, c3);
+        _mm256_storeu_ps(outputs[4] + i, _mm256_shuffle_ps(p, q, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm256_storeu_ps(outputs[5] + i, _mm256_shuffle_ps(p, q, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    DeinterleaveRange(input, 6, i, numFrames, outputs);
+}
+
+// Four 7.1 frames are two 4x4 blocks, front and back channels.
+static void Deinterleave8SSE2(float const* input, size_t /*numChannels*/, size_t numFrames, float* const* outputs)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        float const* frames = input + i * 8;
+
+        for (size_t half = 0; half < 8; half += 4)
+        {
+            __m128 c0 = _mm_loadu_ps(frames + half);
+            __m128 c1 = _mm_loadu_ps(frames + half + 8);
+            __m128 c2 = _mm_loadu_ps(frames + half + 16);
+            __m128 c3 = _mm_loadu_ps(frames + half + 24);
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+            _mm_storeu_ps(outputs[half] + i, c0);
+            _mm_storeu_ps(outputs[half + 1] + i, c1);
+            _mm_storeu_ps(outputs[half + 2] + i, c2);
+            _mm_storeu_ps(outputs[half + 3] + i, c3);
+        }
+    }
+
+    DeinterleaveRange(input, 8, i, numFrames, outputs);
+}
+
+TARGET_AVX2 static void Deinterleave8AVX2(float const* input, size_t /*numChannels*/, size_t numFrames, float* const* outputs)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        float const* frames = input + i * 8;
+
+        for (size_t half = 0; half < 8; half += 4)
+        {
+            __m256 c0 = LoadLanes(frames + half, frames + half + 32);
+            __m256 c1 = LoadLanes(frames + half + 8, frames + half + 40);
+            __m256 c2 = LoadLanes(frames + half + 16, frames + half + 48);
+            __m256 c3 = LoadLanes(frames + half + 24, frames + half + 56);
+            Transpose4(c0, c1, c2, c3);
+
+            _mm256_storeu_ps(outputs[half] + i, c0);
+            _mm256_storeu_ps(outputs[half + 1] + i, c1);
+            _mm256_storeu_ps(outputs[half + 2] + i, c2);
+            _mm256_storeu_ps(outputs[half + 3] + i, c3);
+        }
+    }
+
+    DeinterleaveRange(input, 8, i, numFrames, outputs);
+}
+
+#endif
+
+ConvertKernel SelectConvertKernel(SampleFormat sampleFormat)
+{
+#ifdef SAMPLE_CONVERSION_X86
+    bool hasAVX2 = SDL_HasAVX2() == SDL_TRUE;
+    bool hasSSE2 = SDL_HasSSE2() == SDL_TRUE;
+
+    switch (sampleFormat)
+    {
+    case SampleFormat::Int16:
+        return hasAVX2 ? ConvertInt16AVX2 : hasSSE2 ? ConvertInt16SSE2 : ConvertInt16Scalar;
+    case SampleFormat::Int24:
+        return hasAVX2 ? ConvertInt24AVX2 : ConvertInt24Scalar;
+    case SampleFormat::Int32:
+        return hasAVX2 ? ConvertInt32AVX2 : hasSSE2 ? ConvertInt32SSE2 : ConvertInt32Scalar;
+    case SampleFormat::Float32:
+        return ConvertFloat32;
+    case SampleFormat::Float64:
+        return hasAVX2 ? ConvertFloat64AVX2 : hasSSE2 ? ConvertFloat64SSE2 : ConvertFloat64Scalar;
+    }
+#endif
+
+    switch (sampleFormat)
+    {
+    case SampleFormat::Int16:
+        return ConvertInt16Scalar;
+    case SampleFormat::Int24:
+        return ConvertInt24Scalar;
+    case SampleFormat::Int32:
+        return ConvertInt32Scalar;
+    case SampleFormat::Float32:
+        return ConvertFloat32;
+    case SampleFormat::Float64:
+        return ConvertFloat64Scalar;
+    }
+    return ConvertFloat32;
+}
+
+DeinterleaveKernel SelectDeinterleaveKernel(size_t numChannels)
+{
+    if (numChannels == 1)
+        return DeinterleaveMono;
+
+#ifdef SAMPLE_CONVERSION_X86
+    bool hasAVX2 = SDL_HasAVX2() == SDL_TRUE;
+    bool hasSSE2 = SDL_HasSSE2() == SDL_TRUE;
+
+    switch (numChannels)
+    {
+    case 2:
+        return hasAVX2 ? Deinterleave2AVX2 : hasSSE2 ? Deinterleave2SSE2 : DeinterleaveScalar;
+    case 6:
+        return hasAVX2 ? Deinterleave6AVX2 : hasSSE2 ? Deinterleave6SSE2 : DeinterleaveScalar;
+    case 8:
+        return hasAVX2 ? Deinterleave8AVX2 : hasSSE2 ? Deinterleave8SSE2 : DeinterleaveScalar;
+    }
+#endif
+
+    return DeinterleaveScalar;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+enum class SampleFormat
+{
+    Int16,
+    Int24,
+    Int32,
+    Float32,
+    Float64,
+};
+
+// s16 | s24 | s32 | f32 | f64
+bool ParseSampleFormat(std::string const& name, SampleFormat& sampleFormat);
+size_t GetSampleFormatSize(SampleFormat sampleFormat);
+
+// Converts numSamples samples to floats in [-1, 1).
+typedef void (*ConvertKernel)(void const* input, size_t numSamples, float* output);
+
+// Picks the fastest converter for the format on the running CPU (AVX2, SSE2 or scalar).
+ConvertKernel SelectConvertKernel(SampleFormat sampleFormat);
+
+// Splits numFrames interleaved frames of numChannels samples each into one array per channel.
+typedef void (*DeinterleaveKernel)(float const* input, size_t numChannels, size_t numFrames, float* const* outputs);
+
+// Picks the fastest kernel for the channel count on the running CPU (AVX2, SSE2 or scalar),
+// with dedicated paths for stereo, 5.1 and 7.1.
+DeinterleaveKernel SelectDeinterleaveKernel(size_t numChannels);
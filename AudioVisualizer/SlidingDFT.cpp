@@ -0,0 +1,153 @@
+#include "SlidingDFT.h"
+
+#include <fftw3.h>
+
+#include <stddef.h>
+
+#include <cmath>
+
+#include <algorithm>
+#include <complex>
+#include <vector>
+
+static double const s_pi = 3.14159265358979323846;
+
+// pulls the recursions back by a hundred-thousandth per sample, which shortens the windows by a few percent at most
+static double const s_damping = 0.99999;
+
+// the highest bands would otherwise be a handful of samples long
+static size_t const s_minLength = 32;
+
+// periodic Hann window as three exponentials, in the order of the resonators
+static float const s_hannWeights[] = { -0.25f, 0.5f, -0.25f };
+
+SlidingDFT::SlidingDFT()
+    : m_numChannels()
+    , m_windowNumSamples()
+    , m_isRunning(false)
+{
+}
+
+void SlidingDFT::Reset(size_t sampleRate, size_t numChannels, size_t numBands, float frequencyLow, float frequencyHigh, float scale)
+{
+    frequencyHigh = (std::min)(frequencyHigh, 0.45f * sampleRate);
+    frequencyLow = (std::min)(frequencyLow, frequencyHigh);
+
+    // neighbouring bands overlap where their main lobes meet, as with constant-Q bins
+    double octaves = std::log2((double)frequencyHigh / frequencyLow);
+    double q = numBands > 1 && octaves > 0. ? 1. / (std::pow(2., octaves / (numBands - 1)) - 1.) : 1.;
+
+    m_numChannels = numChannels;
+    m_bands.resize(numBands);
+    m_windowNumSamples = 0;
+
+    for (size_t i = 0; i < numBands; ++i)
+    {
+        Band& band = m_bands[i];
+
+        band.frequency = numBands > 1 ? (float)(frequencyLow * std::pow(2., octaves * i / (numBands - 1))) : frequencyLow;
+        band.length = (std::max)((size_t)std::ceil(q * sampleRate / band.frequency), s_minLength);
+        band.scale = scale / band.length;
+
+        for (size_t r = 0; r < s_numResonators; ++r)
+        {
+            double omega = 2. * s_pi * ((double)band.frequency / sampleRate + ((double)r - 1.) / band.length);
+
+            // the tail has to cancel what the rounded rotation left of the sample, not what an exact one would have
+            band.rotations[r] = std::complex<float>(std::polar(s_damping, -omega));
+            band.exactRotations[r] = std::complex<double>(band.rotations[r]);
+            band.tails[r] = std::complex<float>(std::pow(band.exactRotations[r], (double)band.length));
+        }
+
+        m_windowNumSamples = (std::max)(m_windowNumSamples, band.length);
+    }
+
+    m_states.assign(m_numChannels * numBands * s_numResonators, 0.f);
+    m_isRunning = false;
+}
+
+void SlidingDFT::Restart()
+{
+    m_isRunning = false;
+}
+
+size_t SlidingDFT::GetWindowNumSamples() const
+{
+    return m_windowNumSamples;
+}
+
+size_t SlidingDFT::GetNumBins() const
+{
+    return m_bands.size();
+}
+
+float SlidingDFT::GetFrequency(size_t bin) const
+{
+    return m_bands[bin].frequency;
+}
+
+void SlidingDFT::Update(float const* const* frames, size_t frameNumSamples, size_t numNewSamples, fftwf_complex* output)
+{
+    size_t numBands = m_bands.size();
+
+    // the samples leaving the windows have to still be in the frames
+    bool isSliding = m_isRunning && numNewSamples + m_windowNumSamples <= frameNumSamples;
+
+    for (size_t channel = 0; channel < m_numChannels; ++channel)
+    {
+        float const* data = frames[channel];
+
+        for (size_t b = 0; b < numBands; ++b)
+        {
+            Band const& band = m_bands[b];
+            std::complex<float>* states = &m_states[(channel * numBands + b) * s_numResonators];
+
+            if (isSliding)
+            {
+                std::complex<float> s0 = states[0];
+                std::complex<float> s1 = states[1];
+                std::complex<float> s2 = states[2];
+
+                for (size_t n = frameNumSamples - numNewSamples; n < frameNumSamples; ++n)
+                {
+                    float x = data[n];
+                    float old = data[n - band.length];
+
+                    s0 = x + band.rotations[0] * s0 - band.tails[0] * old;
+                    s1 = x + band.rotations[1] * s1 - band.tails[1] * old;
+                    s2 = x + band.rotations[2] * s2 - band.tails[2] * old;
+                }
+
+                states[0] = s0;
+                states[1] = s1;
+                states[2] = s2;
+            }
+            else
+            {
+                // the same damped sums in one go over the window, newest sample first
+                for (size_t r = 0; r < s_numResonators; ++r)
+                {
+                    std::complex<double> sum = 0.;
+                    std::complex<double> phasor = 1.;
+
+                    for (size_t j = 0; j < band.length; ++j)
+                    {
+                        sum += phasor * (double)data[frameNumSamples - 1 - j];
+                        phasor *= band.exactRotations[r];
+                    }
+
+                    states[r] = std::complex<float>(sum);
+                }
+            }
+
+            std::complex<float> value = 0.f;
+            for (size_t r = 0; r < s_numResonators; ++r)
+                value += s_hannWeights[r] * states[r];
+
+            output[channel * numBands + b][0] = value.real() * band.scale;
+            output[channel * numBands + b][1] = value.imag() * band.scale;
+        }
+    }
+
+    m_isRunning = true;
+}
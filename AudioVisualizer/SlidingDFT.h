@@ -0,0 +1,66 @@
+#pragma once
+
+#include <fftw3.h>
+
+#include <stddef.h>
+
+#include <complex>
+#include <vector>
+
+// A few geometrically spaced bands tracked sample by sample with sliding DFTs, for when only a handful of band
+// levels are needed. Each band slides three DFTs of its own length, one at its center frequency and one a bin to
+// either side, which combine into a Hann-windowed bin, so the cost grows with the number of bands and not with
+// the window length. The recursions are slightly damped so rounding errors die out instead of accumulating.
+class SlidingDFT
+{
+public:
+    SlidingDFT();
+
+    SlidingDFT(SlidingDFT const&) = delete;
+    SlidingDFT(SlidingDFT&&) = delete;
+
+    SlidingDFT& operator=(SlidingDFT const&) = delete;
+    SlidingDFT& operator=(SlidingDFT&&) = delete;
+
+    // a sinusoid of amplitude a comes out with a magnitude of a * scale / 4, the same as a Hann-windowed
+    // FFT of scale samples
+    void Reset(size_t sampleRate, size_t numChannels, size_t numBands, float frequencyLow, float frequencyHigh, float scale);
+    // the next Update() starts over from the samples it is given
+    void Restart();
+
+    // length of the longest band window, that of the lowest band
+    size_t GetWindowNumSamples() const;
+
+    size_t GetNumBins() const;
+    float GetFrequency(size_t bin) const;
+
+    // slides every band over the numNewSamples newest samples of each channel's frame, which has to reach
+    // GetWindowNumSamples() back past them; with fewer samples behind them the bands are computed from scratch.
+    // GetNumBins() complex bins per channel out
+    void Update(float const* const* frames, size_t frameNumSamples, size_t numNewSamples, fftwf_complex* output);
+
+private:
+    // the three DFTs of a band, below, at and above its center
+    static size_t const s_numResonators = 3;
+
+    struct Band
+    {
+        float frequency;
+        size_t length;
+        float scale;
+
+        // damped rotation per sample and the weight of the sample leaving the window
+        std::complex<float> rotations[s_numResonators];
+        std::complex<float> tails[s_numResonators];
+        // the same rotations in double, for the sums from scratch
+        std::complex<double> exactRotations[s_numResonators];
+    };
+
+    size_t m_numChannels;
+    std::vector<Band> m_bands;
+    size_t m_windowNumSamples;
+
+    // per channel and band, the running sums of the three DFTs
+    std::vector<std::complex<float>> m_states;
+    bool m_isRunning;
+};
@@ -0,0 +1,288 @@
+#include "SpectrumKernels.h"
+
+#include <SDL.h>
+
+#include <float.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SPECTRUM_KERNELS_X86
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define SPECTRUM_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+// log2(m) = 2 / ln(2) * (t + t^3 / 3 + t^5 / 5 + t^7 / 7) with t = (m - 1) / (m + 1), m in [sqrt(1/2), sqrt(2)),
+// accurate to about 1e-7, far below what a level can show
+static float const s_log2C1 = 2.88539008f;
+static float const s_log2C3 = 0.961796694f;
+static float const s_log2C5 = 0.577078016f;
+static float const s_log2C7 = 0.412198583f;
+
+static void PowerRange(float const* const* inputs, float const* weights, size_t numInputs, size_t firstBin, size_t numBins, float* power, float& max)
+{
+    for (size_t i = firstBin; i < numBins; ++i)
+    {
+        float real = 0.f;
+        float imag = 0.f;
+
+        for (size_t input = 0; input < numInputs; ++input)
+        {
+            real += weights[input] * inputs[input][i * 2];
+            imag += weights[input] * inputs[input][i * 2 + 1];
+        }
+
+        power[i] = real * real + imag * imag;
+        max = std::fmax(max, power[i]);
+    }
+}
+
+static float PowerScalar(float const* const* inputs, float const* weights, size_t numInputs, size_t numBins, float* power)
+{
+    float max = 0.f;
+    PowerRange(inputs, weights, numInputs, 0, numBins, power, max);
+    return max;
+}
+
+static void DecibelRange(float* spectrum, size_t firstBin, size_t numBins, float scale, float offset)
+{
+    for (size_t i = firstBin; i < numBins; ++i)
+        spectrum[i] = std::fmax(scale * std::log2(std::fmax(spectrum[i], FLT_MIN)) + offset, 0.f);
+}
+
+static void DecibelScalar(float* spectrum, size_t numBins, float scale, float offset)
+{
+    DecibelRange(spectrum, 0, numBins, scale, offset);
+}
+
+static void MagnitudeScalar(float* spectrum, size_t numBins, float scale)
+{
+    for (size_t i = 0; i < numBins; ++i)
+        spectrum[i] = std::sqrt(spectrum[i] * scale);
+}
+
+#ifdef SPECTRUM_KERNELS_X86
+
+// a * b + c; SDL cannot tell whether FMA is there, so no fused multiply-add
+TARGET_AVX2 static inline __m256 MulAdd(__m256 a, __m256 b, __m256 c)
+{
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+}
+
+// four bins per register half, the sums of adjacent squares come out as bins 0 1 4 5 2 3 6 7
+TARGET_AVX2 static float PowerAVX2(float const* const* inputs, float const* weights, size_t numInputs, size_t numBins, float* power)
+{
+    __m256 max = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 8 <= numBins; i += 8)
+    {
+        __m256 lo = _mm256_setzero_ps();
+        __m256 hi = _mm256_setzero_ps();
+
+        for (size_t input = 0; input < numInputs; ++input)
+        {
+            __m256 weight = _mm256_set1_ps(weights[input]);
+
+            lo = MulAdd(weight, _mm256_loadu_ps(inputs[input] + i * 2), lo);
+            hi = MulAdd(weight, _mm256_loadu_ps(inputs[input] + i * 2 + 8), hi);
+        }
+
+        __m256 sums = _mm256_hadd_ps(_mm256_mul_ps(lo, lo), _mm256_mul_ps(hi, hi));
+        sums = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sums), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        _mm256_storeu_ps(power + i, sums);
+        max = _mm256_max_ps(max, sums);
+    }
+
+    __m128 max4 = _mm_max_ps(_mm256_castps256_ps128(max), _mm256_extractf128_ps(max, 1));
+    max4 = _mm_max_ps(max4, _mm_movehl_ps(max4, max4));
+    max4 = _mm_max_ss(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    float maxScalar = _mm_cvtss_f32(max4);
+    PowerRange(inputs, weights, numInputs, i, numBins, power, maxScalar);
+    return maxScalar;
+}
+
+TARGET_AVX2 static inline __m256 Log2AVX2(__m256 x)
+{
+    __m256i bits = _mm256_castps_si256(_mm256_max_ps(x, _mm256_set1_ps(FLT_MIN)));
+
+    __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    __m256 mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+
+    // fold [sqrt(2), 2) onto [sqrt(1/2), 1) so t stays small
+    __m256 isHigh = _mm256_cmp_ps(mantissa, _mm256_set1_ps(1.41421356f), _CMP_GE_OQ);
+    mantissa = _mm256_blendv_ps(mantissa, _mm256_mul_ps(mantissa, _mm256_set1_ps(0.5f)), isHigh);
+    exponent = _mm256_add_ps(exponent, _mm256_and_ps(isHigh, _mm256_set1_ps(1.f)));
+
+    __m256 one = _mm256_set1_ps(1.f);
+    __m256 t = _mm256_div_ps(_mm256_sub_ps(mantissa, one), _mm256_add_ps(mantissa, one));
+    __m256 t2 = _mm256_mul_ps(t, t);
+
+    __m256 polynomial = MulAdd(t2, _mm256_set1_ps(s_log2C7), _mm256_set1_ps(s_log2C5));
+    polynomial = MulAdd(t2, polynomial, _mm256_set1_ps(s_log2C3));
+    polynomial = MulAdd(t2, polynomial, _mm256_set1_ps(s_log2C1));
+
+    return MulAdd(t, polynomial, exponent);
+}
+
+TARGET_AVX2 static void DecibelAVX2(float* spectrum, size_t numBins, float scale, float offset)
+{
+    __m256 scale8 = _mm256_set1_ps(scale);
+    __m256 offset8 = _mm256_set1_ps(offset);
+    size_t i = 0;
+
+    for (; i + 8 <= numBins; i += 8)
+    {
+        __m256 level = MulAdd(scale8, Log2AVX2(_mm256_loadu_ps(spectrum + i)), offset8);
+        _mm256_storeu_ps(spectrum + i, _mm256_max_ps(level, _mm256_setzero_ps()));
+    }
+
+    DecibelRange(spectrum, i, numBins, scale, offset);
+}
+
+TARGET_AVX2 static void MagnitudeAVX2(float* spectrum, size_t numBins, float scale)
+{
+    __m256 scale8 = _mm256_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 8 <= numBins; i += 8)
+        _mm256_storeu_ps(spectrum + i, _mm256_sqrt_ps(_mm256_mul_ps(_mm256_loadu_ps(spectrum + i), scale8)));
+
+    for (; i < numBins; ++i)
+        spectrum[i] = std::sqrt(spectrum[i] * scale);
+}
+
+#endif
+
+#ifdef SPECTRUM_KERNELS_NEON
+
+// vld2q splits the interleaved bins into real and imaginary parts directly
+static float PowerNEON(float const* const* inputs, float const* weights, size_t numInputs, size_t numBins, float* power)
+{
+    float32x4_t max = vdupq_n_f32(0.f);
+    size_t i = 0;
+
+    for (; i + 4 <= numBins; i += 4)
+    {
+        float32x4_t real = vdupq_n_f32(0.f);
+        float32x4_t imag = vdupq_n_f32(0.f);
+
+        for (size_t input = 0; input < numInputs; ++input)
+        {
+            float32x4x2_t bins = vld2q_f32(inputs[input] + i * 2);
+
+            real = vfmaq_n_f32(real, bins.val[0], weights[input]);
+            imag = vfmaq_n_f32(imag, bins.val[1], weights[input]);
+        }
+
+        float32x4_t sums = vfmaq_f32(vmulq_f32(real, real), imag, imag);
+
+        vst1q_f32(power + i, sums);
+        max = vmaxq_f32(max, sums);
+    }
+
+    float maxScalar = vmaxvq_f32(max);
+    PowerRange(inputs, weights, numInputs, i, numBins, power, maxScalar);
+    return maxScalar;
+}
+
+static inline float32x4_t Log2NEON(float32x4_t x)
+{
+    uint32x4_t bits = vreinterpretq_u32_f32(vmaxq_f32(x, vdupq_n_f32(FLT_MIN)));
+
+    float32x4_t exponent = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+    float32x4_t mantissa = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+
+    // fold [sqrt(2), 2) onto [sqrt(1/2), 1) so t stays small
+    uint32x4_t isHigh = vcgeq_f32(mantissa, vdupq_n_f32(1.41421356f));
+    mantissa = vbslq_f32(isHigh, vmulq_n_f32(mantissa, 0.5f), mantissa);
+    exponent = vaddq_f32(exponent, vreinterpretq_f32_u32(vandq_u32(isHigh, vreinterpretq_u32_f32(vdupq_n_f32(1.f)))));
+
+    float32x4_t one = vdupq_n_f32(1.f);
+    float32x4_t t = vdivq_f32(vsubq_f32(mantissa, one), vaddq_f32(mantissa, one));
+    float32x4_t t2 = vmulq_f32(t, t);
+
+    float32x4_t polynomial = vfmaq_f32(vdupq_n_f32(s_log2C5), t2, vdupq_n_f32(s_log2C7));
+    polynomial = vfmaq_f32(vdupq_n_f32(s_log2C3), t2, polynomial);
+    polynomial = vfmaq_f32(vdupq_n_f32(s_log2C1), t2, polynomial);
+
+    return vfmaq_f32(exponent, t, polynomial);
+}
+
+static void DecibelNEON(float* spectrum, size_t numBins, float scale, float offset)
+{
+    float32x4_t offset4 = vdupq_n_f32(offset);
+    size_t i = 0;
+
+    for (; i + 4 <= numBins; i += 4)
+    {
+        float32x4_t level = vfmaq_n_f32(offset4, Log2NEON(vld1q_f32(spectrum + i)), scale);
+        vst1q_f32(spectrum + i, vmaxq_f32(level, vdupq_n_f32(0.f)));
+    }
+
+    DecibelRange(spectrum, i, numBins, scale, offset);
+}
+
+static void MagnitudeNEON(float* spectrum, size_t numBins, float scale)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= numBins; i += 4)
+        vst1q_f32(spectrum + i, vsqrtq_f32(vmulq_n_f32(vld1q_f32(spectrum + i), scale)));
+
+    for (; i < numBins; ++i)
+        spectrum[i] = std::sqrt(spectrum[i] * scale);
+}
+
+#endif
+
+PowerKernel SelectPowerKernel()
+{
+#if defined(SPECTRUM_KERNELS_X86)
+    if (SDL_HasAVX2() == SDL_TRUE)
+        return PowerAVX2;
+#elif defined(SPECTRUM_KERNELS_NEON)
+    if (SDL_HasNEON() == SDL_TRUE)
+        return PowerNEON;
+#endif
+
+    return PowerScalar;
+}
+
+DecibelKernel SelectDecibelKernel()
+{
+#if defined(SPECTRUM_KERNELS_X86)
+    if (SDL_HasAVX2() == SDL_TRUE)
+        return DecibelAVX2;
+#elif defined(SPECTRUM_KERNELS_NEON)
+    if (SDL_HasNEON() == SDL_TRUE)
+        return DecibelNEON;
+#endif
+
+    return DecibelScalar;
+}
+
+MagnitudeKernel SelectMagnitudeKernel()
+{
+#if defined(SPECTRUM_KERNELS_X86)
+    if (SDL_HasAVX2() == SDL_TRUE)
+        return MagnitudeAVX2;
+#elif defined(SPECTRUM_KERNELS_NEON)
+    if (SDL_HasNEON() == SDL_TRUE)
+        return MagnitudeNEON;
+#endif
+
+    return MagnitudeScalar;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+
+// Writes the power |sum of weights[k] * inputs[k][i]|^2 of numBins bins of numInputs interleaved complex spectra
+// (FFTW's layout) and returns the largest of them.
+typedef float (*PowerKernel)(float const* const* inputs, float const* weights, size_t numInputs, size_t numBins, float* power);
+
+// Turns power into a level in place, max(scale * log2(power) + offset, 0).
+typedef void (*DecibelKernel)(float* spectrum, size_t numBins, float scale, float offset);
+
+// Turns power into a magnitude in place, sqrt(power * scale).
+typedef void (*MagnitudeKernel)(float* spectrum, size_t numBins, float scale);
+
+// Pick the fastest kernels on the running CPU (AVX2, NEON or scalar).
+PowerKernel SelectPowerKernel();
+DecibelKernel SelectDecibelKernel();
+MagnitudeKernel SelectMagnitudeKernel();
@@ -2,6 +2,7 @@
 
 #include "AudioCapture.h"
 #include "AudioTransform.h"
+#include "FFTPlanCache.h"
 #include "Plot.h"
 
 #include <Windows.h>
@@ -14,8 +15,24 @@
 #include <cmath>
 
 #include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
 
-Window::Window(bool isScreenSaver)
+// FFTW wisdom is kept next to the other per-user files, or not at all
+static std::string GetWisdomPath()
+{
+    char* prefPath = SDL_GetPrefPath(nullptr, WINDOW_NAME);
+    if (!prefPath)
+        return std::string();
+
+    std::string wisdomPath = std::string(prefPath) + "fftw-wisdom";
+    SDL_free(prefPath);
+
+    return wisdomPath;
+}
+
+Window::Window(bool isScreenSaver, std::string const& audioSource)
     : m_widthMin(200)
     , m_heightMin(100)
     , m_isScreenSaver(isScreenSaver)
@@ -23,9 +40,15 @@ Window::Window(bool isScreenSaver)
     , m_backgroundColor(0, 0, 0)
     , m_window()
     , m_renderer()
+    , m_audioSource(audioSource)
+    , m_fftPlanCache()
     , m_audioCapture()
     , m_audioTransform()
     , m_plot()
+    , m_isReinitializationDone(false)
+    , m_nextAudioCapture()
+    , m_nextAudioTransform()
+    , m_numGlitches()
     , m_hWndPreview(nullptr)
 {
     if (!Initialize())
@@ -40,9 +63,15 @@ Window::Window(HWND hWndPreview)
     , m_backgroundColor(0, 0, 0)
     , m_window()
     , m_renderer()
+    , m_audioSource()
+    , m_fftPlanCache()
     , m_audioCapture()
     , m_audioTransform()
     , m_plot()
+    , m_isReinitializationDone(false)
+    , m_nextAudioCapture()
+    , m_nextAudioTransform()
+    , m_numGlitches()
     , m_hWndPreview(hWndPreview)
 {
     if (!Initialize())
@@ -135,15 +164,23 @@ bool Window::Initialize()
     if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(m_window), &m_displayMode) < 0)
         return false;
 
-    m_audioCapture = new AudioCapture();
-    if (!m_audioCapture->IsInitialized())
+    // the cache only keeps a threaded plan where it measured faster, so every core is on offer
+    m_fftPlanCache = new FFTPlanCache(GetWisdomPath(), FFTW_MEASURE, (int)std::thread::hardware_concurrency());
+    if (!m_fftPlanCache->IsInitialized())
+        return false;
+
+    m_audioCapture = AudioCapture::Create(m_audioSource);
+    if (!m_audioCapture || !m_audioCapture->IsInitialized())
         return false;
 
-    m_audioTransform = new AudioTransform(m_audioCapture);
+    m_audioTransform = new AudioTransform(m_audioCapture, m_fftPlanCache);
     if (!m_audioTransform->IsInitialized())
         return false;
 
-    m_plot = new Plot(this);
+    if (!m_audioCapture->Start())
+        return false;
+
+    m_plot = new Plot(m_audioTransform, m_width, m_height);
 
     m_isInitialized = true;
     return true;
@@ -151,12 +188,24 @@ bool Window::Initialize()
 
 void Window::Destroy()
 {
+    if (m_reinitializationThread.joinable())
+        m_reinitializationThread.join();
+    if (m_retirementThread.joinable())
+        m_retirementThread.join();
+
+    if (m_nextAudioTransform)
+        delete m_nextAudioTransform;
+    if (m_nextAudioCapture)
+        delete m_nextAudioCapture;
+
     if (m_plot)
         delete m_plot;
     if (m_audioTransform)
         delete m_audioTransform;
     if (m_audioCapture)
         delete m_audioCapture;
+    if (m_fftPlanCache)
+        delete m_fftPlanCache;
     if (m_renderer)
         SDL_DestroyRenderer(m_renderer);
     if (m_window)
@@ -249,6 +298,7 @@ bool Window::Run()
                 {
                     SDL_GetRendererOutputSize(m_renderer, &m_width, &m_height);
 
+                    m_plot->SetSize(m_width, m_height);
                     m_plot->CalculateBinValues();
                     m_plot->CalculateSpectrumValues();
                 }
@@ -267,12 +317,75 @@ bool Window::Run()
                     break;
                 }
 
+                // a mouse event's fields overlap the key's, so only a key press is taken for one
+                if (event.type != SDL_KEYDOWN)
+                {
+                    if (event.type == SDL_MOUSEBUTTONDOWN && event.button.clicks == 2)
+                        ToggleFullScreen();
+
+                    break;
+                }
+
                 if (event.key.keysym.sym == SDLK_d)
                 {
                     m_audioTransform->ToggleDecibelMode();
                 }
-                else if (event.button.clicks == 2 ||
-                    event.key.keysym.sym == SDLK_F11 ||
+                else if (event.key.keysym.sym == SDLK_w)
+                {
+                    int type = ((int)m_audioTransform->GetWindowFunction() + 1) % ((int)WindowFunctionType::Kaiser + 1);
+
+                    m_audioTransform->SetWindowFunction((WindowFunctionType)type);
+                }
+                else if (event.key.keysym.sym == SDLK_o)
+                {
+                    // none, 50% and 75%
+                    float overlap = m_audioTransform->GetOverlap();
+
+                    m_audioTransform->SetOverlap(overlap == 0.f ? 0.5f : overlap == 0.5f ? 0.75f : 0.f);
+                }
+                else if (event.key.keysym.sym == SDLK_a)
+                {
+                    int aggregation = ((int)m_audioTransform->GetAggregation() + 1) % ((int)SpectrumAggregation::Max + 1);
+
+                    m_audioTransform->SetAggregation((SpectrumAggregation)aggregation);
+                }
+                else if (event.key.keysym.sym == SDLK_z)
+                {
+                    // zero-pad to 1x, 2x and 4x the window for finer bin spacing
+                    size_t zeroPadding = m_audioTransform->GetZeroPadding() % 4 * 2;
+
+                    m_audioTransform->SetFFTSize(m_audioTransform->GetFFTSizeRounding(), zeroPadding ? zeroPadding : 1);
+                    m_plot->CalculateSpectrumValues();
+                }
+                else if (event.key.keysym.sym == SDLK_m)
+                {
+                    int mode = ((int)m_audioTransform->GetAnalysisMode() + 1) % ((int)AnalysisMode::Filterbank + 1);
+
+                    m_audioTransform->SetAnalysisMode((AnalysisMode)mode);
+                    m_plot->CalculateSpectrumValues();
+                }
+                else if (event.key.keysym.sym == SDLK_q)
+                {
+                    // 12, 24 and 36 constant-Q bins per octave
+                    m_audioTransform->SetBinsPerOctave(m_audioTransform->GetBinsPerOctave() % 36 + 12);
+                    m_plot->CalculateSpectrumValues();
+                }
+                else if (event.key.keysym.sym == SDLK_f)
+                {
+                    int distribution = ((int)m_plot->GetFrequencyDistribution() + 1) % ((int)FrequencyDistribution::OutSine + 1);
+
+                    m_plot->SetFrequencyDistribution((FrequencyDistribution)distribution);
+                    m_plot->CalculateSpectrumValues();
+                }
+                else if (event.key.keysym.sym == SDLK_b)
+                {
+                    // 8, 16 and 32 sliding DFT bands
+                    size_t numBands = m_audioTransform->GetNumBands();
+
+                    m_audioTransform->SetNumBands(numBands < 32 ? numBands * 2 : 8);
+                    m_plot->CalculateSpectrumValues();
+                }
+                else if (event.key.keysym.sym == SDLK_F11 ||
                     event.key.keysym.mod & KMOD_ALT && (event.key.keysym.sym == SDLK_RETURN || event.key.keysym.sym == SDLK_KP_ENTER) ||
                     event.key.keysym.sym == SDLK_ESCAPE && IsFullScreen())
                 {
@@ -305,25 +418,27 @@ void Window::Tick()
 
     if (m_audioCapture->IsInitialized() && m_audioTransform->IsInitialized())
     {
-        if (m_audioCapture->DidDefaultDeviceChange())
-        {
-            m_audioCapture->DestroyDefaultDeviceCapture();
-            m_audioCapture->InitializeDefaultDeviceCapture();
+        // the flag is left pending while a reinitialization is underway
+        if (!m_reinitializationThread.joinable() && m_audioCapture->DidDeviceChange())
+            BeginAudioReinitialization();
 
-            m_audioTransform->DestroyFFT();
-            m_audioTransform->InitializeFFT();
-
-            m_plot->CalculateSpectrumValues();
-        }
+        if (m_isReinitializationDone)
+            FinishAudioReinitialization();
 
         if (m_audioCapture->Capture())
         {
             m_audioTransform->Transform();
-            m_plot->Update();
+            m_plot->Update(GetDeltaTime(), GetDeltaTimeTarget());
+        }
+
+        if (m_audioCapture->GetNumGlitches() != m_numGlitches)
+        {
+            m_numGlitches = m_audioCapture->GetNumGlitches();
+            std::cerr << "Audio glitch detected (" << m_numGlitches << " so far)" << std::endl;
         }
     }
 
-    m_plot->Render();
+    m_plot->Render(m_renderer);
 
     SDL_RenderPresent(m_renderer);
 
@@ -331,3 +446,104 @@ void Window::Tick()
     if (GetDeltaTimeTarget() > m_frameTime)
         SDL_Delay((Uint32)std::roundf(GetDeltaTimeTarget() - m_frameTime));
 }
+
+void Window::BeginAudioReinitialization()
+{
+    m_isReinitializationDone = false;
+
+    try
+    {
+        m_reinitializationThread = std::thread(&Window::ReinitializeAudio, this, m_plot->GetNumBins(), m_plot->GetFrequencyDistribution());
+    }
+    catch (...)
+    {
+        std::cerr << "Could not start audio reinitialization" << std::endl;
+    }
+}
+
+void Window::ReinitializeAudio(size_t numBins, FrequencyDistribution distribution)
+{
+    // joins the process-wide multithreaded apartment the main thread created
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    AudioCapture* capture = AudioCapture::Create(m_audioSource);
+    AudioTransform* transform = nullptr;
+
+    if (capture && capture->IsInitialized())
+        transform = new AudioTransform(capture, m_fftPlanCache);
+
+    if (transform && transform->IsInitialized() && capture->Start())
+    {
+        m_nextSpectrumMapping = m_plot->CalculateSpectrumMapping(transform, numBins, distribution);
+        m_nextAudioCapture = capture;
+        m_nextAudioTransform = transform;
+    }
+    else
+    {
+        std::cerr << "Could not reinitialize audio, keeping the current device" << std::endl;
+
+        if (transform)
+            delete transform;
+        if (capture)
+            delete capture;
+    }
+
+    if (SUCCEEDED(hr))
+        CoUninitialize();
+
+    m_isReinitializationDone = true;
+}
+
+void Window::FinishAudioReinitialization()
+{
+    m_reinitializationThread.join();
+    m_isReinitializationDone = false;
+
+    if (!m_nextAudioCapture)
+        return;
+
+    AudioCapture* audioCapture = m_audioCapture;
+    AudioTransform* audioTransform = m_audioTransform;
+
+    // the mapping was calculated for the default spectrum layout
+    bool didSpectrumLayoutChange = m_nextAudioTransform->CopySettings(audioTransform);
+
+    m_audioCapture = m_nextAudioCapture;
+    m_audioTransform = m_nextAudioTransform;
+    m_nextAudioCapture = nullptr;
+    m_nextAudioTransform = nullptr;
+    m_numGlitches = 0;
+
+    m_plot->SetAudioTransform(m_audioTransform);
+
+    // the plot keeps its bars, only the spectrum mapping changes; a resize or another distribution in the meantime
+    // invalidates it
+    if (m_nextSpectrumMapping.numBins == m_plot->GetNumBins() &&
+        m_nextSpectrumMapping.distribution == m_plot->GetFrequencyDistribution() &&
+        !didSpectrumLayoutChange)
+        m_plot->SetSpectrumMapping(std::move(m_nextSpectrumMapping));
+    else
+        m_plot->CalculateSpectrumValues();
+
+    if (m_retirementThread.joinable())
+        m_retirementThread.join();
+
+    try
+    {
+        m_retirementThread = std::thread([audioCapture, audioTransform]()
+        {
+            HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+            delete audioTransform;
+            delete audioCapture;
+
+            if (SUCCEEDED(hr))
+                CoUninitialize();
+        });
+    }
+    catch (...)
+    {
+        delete audioTransform;
+        delete audioCapture;
+    }
+}
@@ -2,6 +2,7 @@
 
 #include "IInitializable.h"
 #include "IRunnable.h"
+#include "Plot.h"
 
 #include <Windows.h>
 
@@ -9,19 +10,23 @@
 #include <SDL_syswm.h>
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <atomic>
+#include <string>
+#include <thread>
 #include <tuple>
 
 class AudioCapture;
 class AudioTransform;
-class Plot;
+class FFTPlanCache;
 
 class Window
     : public IInitializable
     , public IRunnable
 {
 public:
-    Window(bool isScreenSaver);
+    Window(bool isScreenSaver, std::string const& audioSource = std::string());
     Window(HWND hWndPreview);
 
     Window(Window const&) = delete;
@@ -52,6 +57,11 @@ private:
 
     void Tick();
 
+    // a new pipeline is built on a worker thread while the current one keeps running, then swapped in between frames
+    void BeginAudioReinitialization();
+    void ReinitializeAudio(size_t numBins, FrequencyDistribution distribution);
+    void FinishAudioReinitialization();
+
     int m_width;
     int m_height;
     int m_widthMin;
@@ -67,11 +77,23 @@ private:
     SDL_Renderer* m_renderer;
     SDL_DisplayMode m_displayMode;
 
+    std::string m_audioSource;
+    FFTPlanCache* m_fftPlanCache;
     AudioCapture* m_audioCapture;
     AudioTransform* m_audioTransform;
     Plot* m_plot;
 
+    std::thread m_reinitializationThread;
+    std::atomic<bool> m_isReinitializationDone;
+    AudioCapture* m_nextAudioCapture;
+    AudioTransform* m_nextAudioTransform;
+    Plot::SpectrumMapping m_nextSpectrumMapping;
+
+    // the old pipeline is torn down off the render thread as well
+    std::thread m_retirementThread;
+
     Uint32 m_frameTime;
+    uint64_t m_numGlitches;
 
     HWND m_hWndPreview;
 };
@@ -0,0 +1,62 @@
+#include "WindowFunction.h"
+
+#include <stddef.h>
+
+#include <array>
+#include <vector>
+
+// the default window at the default 25 ms for the two common mix rates
+static constexpr std::array<float, 1103> s_hann44100 = MakeWindowTable<1103>(WindowFunctionType::Hann);
+static constexpr std::array<float, 1200> s_hann48000 = MakeWindowTable<1200>(WindowFunctionType::Hann);
+
+WindowFunction::WindowFunction()
+    : m_type(WindowFunctionType::Hann)
+    , m_size()
+    , m_data()
+{
+}
+
+void WindowFunction::Reset(WindowFunctionType type, size_t size)
+{
+    m_type = type;
+    m_size = size;
+
+    if (type == WindowFunctionType::Hann && size == s_hann44100.size())
+    {
+        m_data = s_hann44100.data();
+    }
+    else if (type == WindowFunctionType::Hann && size == s_hann48000.size())
+    {
+        m_data = s_hann48000.data();
+    }
+    else
+    {
+        m_table.resize(size);
+        for (size_t i = 0; i < size; ++i)
+            m_table[i] = GetWindowCoefficient(type, i, size);
+
+        m_data = m_table.data();
+    }
+}
+
+WindowFunctionType WindowFunction::GetType() const
+{
+    return m_type;
+}
+
+size_t WindowFunction::GetSize() const
+{
+    return m_size;
+}
+
+float const* WindowFunction::GetData() const
+{
+    return m_data;
+}
+
+void WindowFunction::Apply(float const* input, float* output) const
+{
+    // kept trivial so it vectorizes
+    for (size_t i = 0; i < m_size; ++i)
+        output[i] = input[i] * m_data[i];
+}
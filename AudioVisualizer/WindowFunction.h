@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+enum class WindowFunctionType
+{
+    Hann,
+    Hamming,
+    BlackmanHarris,
+    FlatTop,
+    Kaiser,
+};
+
+namespace WindowFunctionDetail
+{
+    constexpr double Pi = 3.14159265358979323846;
+
+    // constexpr stand-ins for std::cos, std::sqrt and the modified Bessel function I0
+
+    constexpr double Cos(double x)
+    {
+        while (x > Pi)
+            x -= 2. * Pi;
+        while (x < -Pi)
+            x += 2. * Pi;
+
+        double term = 1.;
+        double sum = 1.;
+
+        for (int k = 1; k < 24; ++k)
+        {
+            term *= -x * x / ((2. * k - 1.) * (2. * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double Sqrt(double x)
+    {
+        if (x <= 0.)
+            return 0.;
+
+        double y = x > 1. ? x : 1.;
+        for (int k = 0; k < 64; ++k)
+            y = 0.5 * (y + x / y);
+        return y;
+    }
+
+    constexpr double BesselI0(double x)
+    {
+        double term = 1.;
+        double sum = 1.;
+
+        for (int k = 1; k < 64 && term > sum * 1e-12; ++k)
+        {
+            term *= (x / (2. * k)) * (x / (2. * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // generalized cosine window, a[0] - a[1] cos(x) + a[2] cos(2x) - ...
+    template <size_t NumTerms>
+    constexpr double Cosine(double const (&a)[NumTerms], double x)
+    {
+        double sum = 0.;
+        for (size_t k = 0; k < NumTerms; ++k)
+            sum += (k % 2 ? -a[k] : a[k]) * Cos(k * x);
+        return sum;
+    }
+}
+
+// Periodic (DFT-even) window coefficient i of size, usable at compile time.
+constexpr float GetWindowCoefficient(WindowFunctionType type, size_t i, size_t size, float kaiserBeta = 8.6f)
+{
+    using namespace WindowFunctionDetail;
+
+    double const hann[] = { 0.5, 0.5 };
+    double const hamming[] = { 0.54, 0.46 };
+    double const blackmanHarris[] = { 0.35875, 0.48829, 0.14128, 0.01168 };
+    double const flatTop[] = { 0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368 };
+
+    double x = 2. * Pi * i / size;
+    double r = 2. * i / size - 1.;
+
+    switch (type)
+    {
+    case WindowFunctionType::Hann:
+        return (float)Cosine(hann, x);
+    case WindowFunctionType::Hamming:
+        return (float)Cosine(hamming, x);
+    case WindowFunctionType::BlackmanHarris:
+        return (float)Cosine(blackmanHarris, x);
+    case WindowFunctionType::FlatTop:
+        return (float)Cosine(flatTop, x);
+    case WindowFunctionType::Kaiser:
+        return (float)(BesselI0(kaiserBeta * Sqrt(1. - r * r)) / BesselI0(kaiserBeta));
+    }
+    return 1.f;
+}
+
+namespace WindowFunctionDetail
+{
+    // std::array's operator[] is not constexpr before C++17, so the table is built from a pack of indices
+    template <size_t Size, size_t... Indices>
+    constexpr std::array<float, Size> MakeWindowTable(WindowFunctionType type, float kaiserBeta, std::index_sequence<Indices...>)
+    {
+        return { { GetWindowCoefficient(type, Indices, Size, kaiserBeta)... } };
+    }
+}
+
+template <size_t Size>
+constexpr std::array<float, Size> MakeWindowTable(WindowFunctionType type, float kaiserBeta = 8.6f)
+{
+    return WindowFunctionDetail::MakeWindowTable<Size>(type, kaiserBeta, std::make_index_sequence<Size>());
+}
+
+// Coefficients for one window size, computed once and applied while copying
+// samples into the FFT input.
+class WindowFunction
+{
+public:
+    WindowFunction();
+
+    WindowFunction(WindowFunction const&) = delete;
+    WindowFunction(WindowFunction&&) = delete;
+
+    WindowFunction& operator=(WindowFunction const&) = delete;
+    WindowFunction& operator=(WindowFunction&&) = delete;
+
+    void Reset(WindowFunctionType type, size_t size);
+
+    WindowFunctionType GetType() const;
+    size_t GetSize() const;
+    float const* GetData() const;
+
+    // output[i] = input[i] * window[i]
+    void Apply(float const* input, float* output) const;
+
+private:
+    WindowFunctionType m_type;
+    size_t m_size;
+
+    // points either into m_table or at a table baked in at compile time
+    float const* m_data;
+    std::vector<float> m_table;
+};